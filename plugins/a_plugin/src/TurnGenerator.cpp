@@ -258,7 +258,7 @@ void TurnGenerator::compute()
 
 		auto done = std::chrono::high_resolution_clock::now();
 
-		if (LOG_LEVEL  <= qcore::util::Log::Debug)
+		if (qcore::util::Log::isEnabled(qcore::util::Log::Debug, DOM))
 		{
 			print_gen_tree(1, this);
 		}
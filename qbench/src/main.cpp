@@ -0,0 +1,440 @@
+#include "GameController.h"
+#include "GameServer.h"
+#include "RemoteGame.h"
+#include "SearchState.h"
+#include "QcoreUtil.h"
+
+#include <ConsoleApp.h>
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <ctime>
+#include <list>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <random>
+#include <cstring>
+
+typedef const qcli::ConsoleApp::CliArgs& qarg;
+
+/** Default number of simulated clients, two per game */
+const uint32_t DEFAULT_CLIENTS = 64;
+
+/** Default number of moves played in each game */
+const uint32_t DEFAULT_MOVES = 1000;
+
+/** Default number of random games of the search state check */
+const uint32_t DEFAULT_SEARCH_GAMES = 100;
+
+/** Maximum number of actions of a random game */
+const uint32_t SEARCH_GAME_ACTIONS = 200;
+
+/** Maximum number of mismatches printed */
+const uint64_t MAX_PRINTED_MISMATCHES = 10;
+
+/** Results of the search state check */
+struct SearchCheck
+{
+   uint64_t checks = 0;
+   uint64_t mismatches = 0;
+
+   /** Actions generated and time spent generating them */
+   uint64_t generated = 0;
+   std::chrono::nanoseconds generationTime{0};
+};
+
+/** Counts a check. The first mismatches are printed, with the game and the action number. */
+void Check(std::ostream& out, SearchCheck& check, bool ok, const char* what, uint32_t game, uint32_t action)
+{
+   ++check.checks;
+
+   if (not ok and ++check.mismatches <= MAX_PRINTED_MISMATCHES)
+   {
+      out << "Mismatch in game " << game << " before action " << action << ": " << what << std::endl;
+   }
+}
+
+/** Compares two search states, field by field */
+bool SameState(const qcore::SearchState& a, const qcore::SearchState& b)
+{
+   if (a.getHash() != b.getHash() or a.getCurrentPlayer() != b.getCurrentPlayer() or a.getWinner() != b.getWinner() or
+      std::memcmp(&a.getBitBoard(), &b.getBitBoard(), sizeof(qcore::BitBoard)) != 0)
+   {
+      return false;
+   }
+
+   for (qcore::PlayerId id = 0; id < a.getNumberOfPlayers(); ++id)
+   {
+      if (a.getWallsLeft(id) != b.getWallsLeft(id))
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+/**
+ * Checks one position of a game: the player on move, the hash, every pawn square and wall slot
+ * against the game rules, and the undo of every legal action. Returns the number of legal actions.
+ */
+size_t CheckPosition(std::ostream& out, SearchCheck& check, const qcore::Game& game, const qcore::SearchState& state,
+   qcore::PlayerAction* actions, uint32_t gameIndex, uint32_t actionIndex)
+{
+   using namespace qcore;
+
+   auto verify = [&](bool ok, const char* what) { Check(out, check, ok, what, gameIndex, actionIndex); };
+   PlayerId current = game.getCurrentPlayer();
+   std::string reason;
+
+   verify(state.getCurrentPlayer() == current, "player on move");
+   verify(state.getHash() == game.getBoardState()->getHash(), "hash of the game's board");
+   verify(state.isFinished() == game.getBoardState()->isFinished(), "end of the game");
+
+   auto start = std::chrono::steady_clock::now();
+   size_t count = state.generateActions(actions);
+   check.generationTime += std::chrono::steady_clock::now() - start;
+   check.generated += count;
+
+   bool generatedMoves[BOARD_SQUARES] = {};
+   bool generatedWalls[2][WALL_SLOTS * WALL_SLOTS] = {};
+
+   for (size_t i = 0; i < count; ++i)
+   {
+      if (actions[i].actionType == ActionType::Move)
+      {
+         generatedMoves[BitBoard::square(actions[i].playerPosition)] = true;
+      }
+      else
+      {
+         generatedWalls[static_cast<int>(actions[i].wallState.orientation)][BitBoard::wallSlot(actions[i].wallState)] = true;
+      }
+
+      // Undone in place, the state must be restored exactly
+      SearchState undone = state;
+      ActionUndo undo = undone.doAction(actions[i]);
+      undone.undoAction(undo);
+      verify(SameState(undone, state), "undo of an action");
+   }
+
+   if (state.isFinished())
+   {
+      return count;
+   }
+
+   PlayerAction action;
+   action.playerId = current;
+   action.actionType = ActionType::Move;
+
+   for (uint8_t square = 0; square < BOARD_SQUARES; ++square)
+   {
+      action.playerPosition = BitBoard::position(square);
+      bool legal = game.isActionValid(state.toRelative(action), reason);
+
+      verify(state.isLegal(action) == legal, "legal pawn move");
+      verify(generatedMoves[square] == legal, "generated pawn move");
+   }
+
+   action.actionType = ActionType::Wall;
+
+   for (Orientation o : { Orientation::Vertical, Orientation::Horizontal })
+   {
+      for (uint8_t slot = 0; slot < WALL_SLOTS * WALL_SLOTS; ++slot)
+      {
+         // Middle point of the wall on the slot, as in BitBoard::wallSlot
+         action.wallState.orientation = o;
+         action.wallState.position = o == Orientation::Vertical ?
+            Position(slot / WALL_SLOTS, slot % WALL_SLOTS + 1) :
+            Position(slot / WALL_SLOTS + 1, slot % WALL_SLOTS);
+
+         bool legal = game.isActionValid(state.toRelative(action), reason);
+
+         verify(state.isLegal(action) == legal, "legal wall placement");
+         verify(generatedWalls[static_cast<int>(o)][slot] == legal, "generated wall placement");
+      }
+   }
+
+   return count;
+}
+
+void RunCommand_Search(std::ostream& out, qarg args)
+{
+   using namespace qcore;
+
+   uint32_t games = args.isSet("-g") ? std::stoul(args.getValue("<games>")) : DEFAULT_SEARCH_GAMES;
+   uint32_t seed = args.isSet("-s") ? std::stoul(args.getValue("<seed>")) : 1;
+
+   // Like the game controllers, which the check doesn't use
+   LOG_INIT("quoridor.log");
+
+   std::mt19937 random(seed);
+   SearchCheck check;
+   PlayerAction actions[MAX_ACTIONS];
+   uint32_t positions = 0;
+
+   out << "Checking the search state on " << games << " random games, seed " << seed << " ..." << std::endl;
+
+   auto start = std::chrono::steady_clock::now();
+
+   for (uint32_t g = 0; g < games; ++g)
+   {
+      Game game(g % 2 ? 4 : 2);
+      SearchState state(*game.getBoardState()->getSnapshot(), game.getCurrentPlayer());
+
+      for (uint32_t a = 0; a < SEARCH_GAME_ACTIONS; ++a, ++positions)
+      {
+         size_t count = CheckPosition(out, check, game, state, actions, g, a);
+
+         if (state.isFinished() or count == 0)
+         {
+            break;
+         }
+
+         // Moves are picked as often as walls, otherwise the walls would run out first
+         size_t moves = 0;
+
+         while (moves < count and actions[moves].actionType == ActionType::Move)
+         {
+            ++moves;
+         }
+
+         bool move = moves == count or (moves and random() % 2);
+         const PlayerAction& action = move ? actions[random() % moves] : actions[moves + random() % (count - moves)];
+
+         std::string reason;
+         state.doAction(action);
+         Check(out, check, game.processPlayerAction(state.toRelative(action), reason), "action accepted by the game", g, a);
+
+         // Built from the game's board, the state must equal the one updated in place
+         SearchState rebuilt(*game.getBoardState()->getSnapshot(), game.getCurrentPlayer());
+         Check(out, check, SameState(rebuilt, state), "state after the action", g, a);
+      }
+   }
+
+   double durationSec = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / 1e9;
+   double generationSec = check.generationTime.count() / 1e9;
+
+   out << std::fixed << std::setprecision(2)
+      << "\nPositions: " << positions << ", checks: " << check.checks << ", mismatches: " << check.mismatches
+      << ", duration: " << durationSec << " sec\n"
+      << "Actions generated: " << check.generated << ", per sec: " << (generationSec > 0 ? check.generated / generationSec : 0.0) << "\n";
+
+   if (check.mismatches)
+   {
+      throw util::Exception(std::to_string(check.mismatches) + " mismatches between the search state and the game");
+   }
+}
+
+#ifdef BOOST_AVAILABLE
+
+/**
+ * Game played by two simulated clients. Each player steps sideways on his start row and back, so
+ * the game never ends, and sends his next move as soon as the previous one was acknowledged.
+ */
+struct ScriptedGame
+{
+   qcore::GameController host;
+   qcore::RemoteGamePtr clients[2];
+
+   uint32_t moves = 0;
+   bool failed = false;
+
+   /** Round trip of each move, from the request to the server response */
+   std::vector<std::chrono::nanoseconds> latencies;
+};
+
+/** Progress of the scripted games, shared by the IO threads of the clients */
+struct BenchState
+{
+   uint32_t moves = 0;
+   uint32_t running = 0;
+   std::mutex mutex;
+   std::condition_variable finishedCv;
+};
+
+/** Returns the next scripted move of the player on move. Positions are relative to the player. */
+qcore::PlayerAction ScriptedAction(const ScriptedGame& game)
+{
+   qcore::PlayerAction action;
+   action.playerId = game.moves % 2;
+   action.actionType = qcore::ActionType::Move;
+   action.playerPosition = qcore::Position(
+      qcore::BOARD_SIZE - 1,
+      (game.moves / 2) % 2 ? qcore::BOARD_SIZE / 2 : qcore::BOARD_SIZE / 2 + 1);
+
+   return action;
+}
+
+/** Sends the next move of the game. Called again from the IO thread of the client when the server responds. */
+void PlayNextMove(ScriptedGame& game, BenchState& state, uint32_t maxMoves)
+{
+   auto finish = [&]()
+   {
+      std::lock_guard<std::mutex> lock(state.mutex);
+      state.moves += game.moves;
+      --state.running;
+      state.finishedCv.notify_all();
+   };
+
+   auto sent = std::chrono::steady_clock::now();
+   auto action = ScriptedAction(game);
+
+   try
+   {
+      game.clients[action.playerId]->processPlayerActionAsync(action, [&game, &state, maxMoves, sent, finish](bool success, const std::string&)
+      {
+         game.latencies.push_back(std::chrono::steady_clock::now() - sent);
+
+         if (not success)
+         {
+            game.failed = true;
+            finish();
+         }
+         else if (++game.moves == maxMoves)
+         {
+            finish();
+         }
+         else
+         {
+            PlayNextMove(game, state, maxMoves);
+         }
+      });
+   }
+   catch (std::exception&)
+   {
+      game.failed = true;
+      finish();
+   }
+}
+
+/** Returns the latency at the given percentile, in milliseconds */
+double Percentile(const std::vector<std::chrono::nanoseconds>& sorted, double percentile)
+{
+   if (sorted.empty())
+   {
+      return 0.0;
+   }
+
+   size_t index = std::min(sorted.size() - 1, size_t(percentile / 100.0 * sorted.size()));
+   return sorted[index].count() / 1e6;
+}
+
+void RunCommand_Remote(std::ostream& out, qarg args)
+{
+   uint32_t clients = args.isSet("-c") ? std::stoul(args.getValue("<clients>")) : DEFAULT_CLIENTS;
+   uint32_t maxMoves = args.isSet("-m") ? std::stoul(args.getValue("<moves>")) : DEFAULT_MOVES;
+   size_t ioThreads = args.isSet("-j") ? std::stoul(args.getValue("<io-threads>")) : 0;
+   uint32_t games = std::max(1u, clients / 2);
+
+   if (maxMoves == 0)
+   {
+      throw qcore::util::Exception("At least one move must be played");
+   }
+
+   auto server = std::make_shared<qcore::GameServer>(ioThreads);
+   server->startServer("quoridor-bench");
+
+   // Shared by all clients. The games are driven by the script, the server never asks for a move.
+   qcore::GameController clientController;
+
+   BenchState state;
+   std::list<ScriptedGame> scriptedGames;
+
+   out << "Connecting " << games * 2 << " clients to " << games << " games on localhost ..." << std::endl;
+
+   for (uint32_t i = 0; i < games; ++i)
+   {
+      scriptedGames.emplace_back();
+      ScriptedGame& game = scriptedGames.back();
+      qcore::GameId gameId = game.host.hostGame(server, "bench " + std::to_string(i), 2);
+
+      for (int p = 0; p < 2; ++p)
+      {
+         game.clients[p] = std::make_shared<qcore::RemoteGame>(clientController, 2, "127.0.0.1");
+         game.clients[p]->joinGame(gameId);
+         game.clients[p]->addRemotePlayer("P" + std::to_string(p));
+      }
+
+      game.latencies.reserve(maxMoves);
+   }
+
+   auto serverCpuStart = server->getIoCpuTime();
+   auto cpuStart = std::clock();
+   auto start = std::chrono::steady_clock::now();
+
+   state.running = games;
+
+   for (auto& game : scriptedGames)
+   {
+      PlayNextMove(game, state, maxMoves);
+   }
+
+   {
+      std::unique_lock<std::mutex> lock(state.mutex);
+      state.finishedCv.wait(lock, [&]{ return state.running == 0; });
+   }
+
+   auto durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+   double serverCpuSec = (server->getIoCpuTime() - serverCpuStart).count() / 1e9;
+   double cpuSec = double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+   double durationSec = durationNs / 1e9;
+
+   std::vector<std::chrono::nanoseconds> latencies;
+   uint32_t failed = 0;
+
+   for (auto& game : scriptedGames)
+   {
+      latencies.insert(latencies.end(), game.latencies.begin(), game.latencies.end());
+      failed += game.failed;
+   }
+
+   std::sort(latencies.begin(), latencies.end());
+
+   // Each move is a request, its response, and a board update for both clients of the game
+   uint64_t messages = uint64_t(state.moves) * 4;
+
+   out << std::fixed << std::setprecision(2)
+      << "\nGames: " << games << " (" << failed << " failed), moves: " << state.moves << ", duration: " << durationSec << " sec\n"
+      << "Moves per sec: " << state.moves / durationSec << ", messages per sec: " << messages / durationSec << "\n"
+      << "Round trip ms: p50 " << Percentile(latencies, 50) << ", p99 " << Percentile(latencies, 99)
+      << ", max " << (latencies.empty() ? 0.0 : latencies.back().count() / 1e6) << "\n"
+      << "Server CPU: " << serverCpuSec << " sec (" << 100 * serverCpuSec / durationSec << "% of a core)"
+      << ", process CPU: " << cpuSec << " sec\n";
+}
+
+#else
+
+void RunCommand_Remote(std::ostream&, qarg)
+{
+   throw qcore::util::Exception("Server implementation not available");
+}
+
+#endif // BOOST_AVAILABLE
+
+int main(int argc, char *argv[])
+{
+   // Setup console application menu
+   qcli::ConsoleApp app(std::cout);
+
+   app.addCommand(RunCommand_Remote, "remote -c <clients> -m <moves> -j <io-threads>", "Benchmark")
+      .setSummary("Plays scripted games between remote clients of a local game server, and prints the message throughput and latency.")
+      .setDescription("Two clients join each game and play <moves> moves (default 1000), each move sent as soon as the previous one was acknowledged.\n"
+                      "The server runs <io-threads> IO threads (default: QUORIDOR_IO_THREADS or all hardware threads).\n"
+                      "EXAMPLE:\n   remote -c 200 -m 500 -j 4");
+
+   app.addCommand(RunCommand_Search, "search -g <games> -s <seed>", "Benchmark")
+      .setSummary("Plays random games with qcore::SearchState, cross-checks it against the game rules and prints the action generation throughput.")
+      .setDescription("Each position of <games> random games (default 100, 2 and 4 players, seed <seed> or 1) checks every pawn square and wall slot\n"
+                      "against Game::isActionValid, the generated actions, the undo of each of them, and the Zobrist hash of the game's board.\n"
+                      "The command fails if any check does.\n"
+                      "EXAMPLE:\n   search -g 500 -s 7");
+
+   app.addCommand([&app](std::ostream &, qarg){ app.printHelp(); }, "help", "General")
+      .setSummary("Prints this menu");
+
+   // Run a single command
+   return app.executeOnce(argc, argv);
+}
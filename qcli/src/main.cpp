@@ -64,57 +64,17 @@ std::string DurationToString(uint32_t ms)
    return ss.str();
 }
 
-uint32_t ComputePath(qcore::PlayerId pId, qcore::BoardStatePtr bs)
+/** Returns the player if he plays on this machine, null for players of a followed remote game */
+qcore::PlayerPtr LocalPlayer(qcore::PlayerId id)
 {
-   uint32_t ret = 0;
-   qcore::Position mp = bs->getPlayers(pId).at(pId).position * 2;
-   qcore::BoardMap map;
-   std::list<std::pair<qcore::Position, uint32_t>> pl;
-   bs->createBoardMap(map, pId);
-
-   if (!mp.x)
-   {
-      return 0;
-   }
-
-   for (uint8_t i = 0; i < qcore::BOARD_MAP_SIZE; i += 2)
+   try
    {
-      map(0, i) = qcore::BoardMap::Invalid;
-      pl.emplace_back(qcore::Position(0, i), 0);
+      return GC.getPlayer(id);
    }
-
-   auto checkPos = [&](const qcore::Position& p, uint32_t l) -> bool
+   catch (std::exception&)
    {
-      if (mp == p)
-      {
-         ret = l + 1;
-         return true;
-      }
-
-      if(map(p) < qcore::BoardMap::HorizontalWall)
-      {
-         map(p) = qcore::BoardMap::Invalid;
-         pl.emplace_back(p, l + 1);
-      }
-
-      return false;
-   };
-
-   while (not pl.empty())
-   {
-      auto p = pl.front();
-      pl.pop_front();
-
-      if ((map(p.first + 1_x) == 0 and checkPos(p.first + 2_x, p.second)) or
-         (map(p.first - 1_x) == 0 and checkPos(p.first - 2_x, p.second)) or
-         (map(p.first + 1_y) == 0 and checkPos(p.first + 2_y, p.second)) or
-         (map(p.first - 1_y) == 0 and checkPos(p.first - 2_y, p.second)))
-      {
-         break;
-      }
+      return nullptr;
    }
-
-   return ret;
 }
 
 void PrintAsciiGameBoard()
@@ -260,27 +220,29 @@ void PrintAsciiGameBoard()
    std::cout << TABLE_BOTTOM_RIGHT_BORDER << TABLE_RIGHT_MARGIN << "\n" << TABLE_BOTTOM_MARGIN;
 
    qcore::PlayerId pId = GC.getGame()->getCurrentPlayer() ^ 1;
+   qcore::PlayerPtr p0 = LocalPlayer(0);
+   qcore::PlayerPtr p1 = LocalPlayer(1);
 
    // Print players state
    std::cout << "                    ";
-   PrintPlayerInfo("P0: " + GC.getPlayer(0)->getName(), pId == 0);
-   PrintPlayerInfo("P1: " + GC.getPlayer(1)->getName(), pId == 1);
+   PrintPlayerInfo("P0: " + (p0 ? p0->getName() : "remote"), pId == 0);
+   PrintPlayerInfo("P1: " + (p1 ? p1->getName() : "remote"), pId == 1);
 
    std::cout << "\n Walls:             ";
-   PrintPlayerInfo(std::to_string((int)GC.getPlayer(0)->getWallsLeft()), pId == 0);
-   PrintPlayerInfo(std::to_string((int)GC.getPlayer(1)->getWallsLeft()), pId == 1);
+   PrintPlayerInfo(std::to_string((int)GC.getBoardState()->getWallsLeft(0)), pId == 0);
+   PrintPlayerInfo(std::to_string((int)GC.getBoardState()->getWallsLeft(1)), pId == 1);
 
    std::cout << "\n Move duration:     ";
-   PrintPlayerInfo(DurationToString(GC.getPlayer(0)->getLastMoveDuration()), pId == 0);
-   PrintPlayerInfo(DurationToString(GC.getPlayer(1)->getLastMoveDuration()), pId == 1);
+   PrintPlayerInfo(p0 ? DurationToString(p0->getLastMoveDuration()) : "-", pId == 0);
+   PrintPlayerInfo(p1 ? DurationToString(p1->getLastMoveDuration()) : "-", pId == 1);
 
    std::cout << "\n Illegal moves:     ";
-   PrintPlayerInfo(std::to_string(GC.getPlayer(0)->getIllegalMoves()), pId == 0);
-   PrintPlayerInfo(std::to_string(GC.getPlayer(1)->getIllegalMoves()), pId == 1);
+   PrintPlayerInfo(p0 ? std::to_string(p0->getIllegalMoves()) : "-", pId == 0);
+   PrintPlayerInfo(p1 ? std::to_string(p1->getIllegalMoves()) : "-", pId == 1);
 
    std::cout << "\n Moves to finish:   ";
-   uint32_t path0 = ComputePath(0, GC.getBoardState());
-   uint32_t path1 = ComputePath(1, GC.getBoardState());
+   uint32_t path0 = GC.getBoardState()->getGoalDistance(0);
+   uint32_t path1 = GC.getBoardState()->getGoalDistance(1);
    PrintPlayerInfo(std::to_string(path0), path0 < path1 ? TEXT_ASCII_COLOR::GREEN : TEXT_ASCII_COLOR::OFF);
    PrintPlayerInfo(std::to_string(path1), path0 > path1 ? TEXT_ASCII_COLOR::GREEN : TEXT_ASCII_COLOR::OFF);
 
@@ -293,7 +255,7 @@ void PrintAsciiGameBoard()
       if (winner != 0xFF)
       {
          std::cout << TEXT_ASCII_COLOR::GREEN << "                        "
-            << GC.getPlayer(GC.getBoardState()->getWinner())->getName() << " won!"
+            << (LocalPlayer(winner) ? LocalPlayer(winner)->getName() : "P" + std::to_string((int) winner)) << " won!"
             << TEXT_ASCII_COLOR::OFF << "\n";
       }
       else
@@ -380,6 +342,16 @@ void RunCommand_ServerDiscovery(std::ostream& out, qarg)
    }
 }
 
+void RunCommand_ServerGames(std::ostream& out, qarg args)
+{
+   auto games = GC.listRemoteGames(args.getValue("<server-ip>"));
+
+   for (auto& g : games)
+   {
+        out << "   " << g.id << ": " << g.name << " (" << (int) g.numberOfPlayers << " players)\n";
+   }
+}
+
 void RunCommand_ServerStart(std::ostream&, qarg args)
 {
    GC.startServer(args.getValue("<server-name>"), args.isSet("-p") ? std::stoi(args.getValue("<players>")) : 2);
@@ -388,10 +360,19 @@ void RunCommand_ServerStart(std::ostream&, qarg args)
 
 void RunCommand_JoinServer(std::ostream&, qarg args)
 {
-   GC.connectToRemoteGame(args.getValue("<server-ip>"));
+   GC.connectToRemoteGame(args.getValue("<server-ip>"), args.isSet("-g") ? std::stoul(args.getValue("<game-id>")) : 0);
    GC.getBoardState()->registerStateChange(PrintAsciiGameBoard);
 }
 
+void RunCommand_Spectate(std::ostream&, qarg args)
+{
+   std::chrono::milliseconds interval(args.isSet("-i") ? std::stoi(args.getValue("<interval-ms>")) : 0);
+
+   GC.spectateRemoteGame(args.getValue("<server-ip>"), interval, args.isSet("-g") ? std::stoul(args.getValue("<game-id>")) : 0);
+   GC.getBoardState()->registerStateChange(PrintAsciiGameBoard);
+   PrintAsciiGameBoard();
+}
+
 int main(int argc, char *argv[])
 {
    qcore::PluginManager::RegisterPlugin<qcli::ConsolePlayer>("qcli::ConsolePlayer");
@@ -434,12 +415,18 @@ int main(int argc, char *argv[])
    app.addCommand(RunCommand_ServerStart, "server start <server-name> -p <players>", "Remote Game Setup")
       .setSummary("Starts a quoridor game server.");
 
-   app.addCommand(RunCommand_JoinServer, "join <server-ip>", "Remote Game Setup")
-      .setSummary("Connects to a remote game server.");
+   app.addCommand(RunCommand_JoinServer, "join <server-ip> -g <game-id>", "Remote Game Setup")
+      .setSummary("Connects to a game of a remote game server, the first one by default.");
+
+   app.addCommand(RunCommand_Spectate, "spectate <server-ip> -i <interval-ms> -g <game-id>", "Remote Game Setup")
+      .setSummary("Follows a remote game, with board updates grouped at the optional interval.");
 
    app.addCommand(RunCommand_ServerDiscovery, "server discovery", "Remote Game Setup")
       .setSummary("Starts a server discovery and lists all found servers.");
 
+   app.addCommand(RunCommand_ServerGames, "server games <server-ip>", "Remote Game Setup")
+      .setSummary("Lists the games hosted by a game server.");
+
    app.addCommand(RunCommand_Move, "move <direction>", "Player Actions")
       .setSummary("Moves the current player in the specified direction (up, down, left, right)")
       .registerParameterAutocompleteCb(
@@ -0,0 +1,143 @@
+#ifndef Header_qcore_BitBoard
+#define Header_qcore_BitBoard
+
+#include "Qcore_API.h"
+#include "PlayerAction.h"
+
+namespace qcore
+{
+   /** Maximum number of players in a game */
+   const uint8_t MAX_PLAYERS = 4;
+
+   /** Number of wall slots on each row / column. Walls are placed in between pawn squares. */
+   const uint8_t WALL_SLOTS = BOARD_SIZE - 1;
+
+   /** Number of pawn squares on the board */
+   const uint8_t BOARD_SQUARES = BOARD_SIZE * BOARD_SIZE;
+
+   /** Marks an unused pawn square */
+   const uint8_t NO_SQUARE = 0xFF;
+
+   /**
+    * Wall slots in conflict with each wall, generated at compile time: the slot of the wall in both
+    * orientations (overlapping or crossing at the middle point) and the adjacent slots of the same
+    * orientation (overlapping halves).
+    */
+   struct WallConflicts
+   {
+      /** Conflicting slots, indexed by orientation of the wall, orientation of the slots and wall's slot */
+      uint64_t masks[2][2][WALL_SLOTS * WALL_SLOTS];
+
+      constexpr WallConflicts() :
+         masks{}
+      {
+         for (int slot = 0; slot < WALL_SLOTS * WALL_SLOTS; ++slot)
+         {
+            uint64_t bit = uint64_t(1) << slot;
+            int row = slot / WALL_SLOTS;
+            int column = slot % WALL_SLOTS;
+
+            masks[0][0][slot] = masks[0][1][slot] = masks[1][0][slot] = masks[1][1][slot] = bit;
+
+            // Vertical walls overlap the ones above and below, horizontal walls the ones on their sides
+            masks[0][0][slot] |= (row > 0 ? bit >> WALL_SLOTS : 0) | (row < WALL_SLOTS - 1 ? bit << WALL_SLOTS : 0);
+            masks[1][1][slot] |= (column > 0 ? bit >> 1 : 0) | (column < WALL_SLOTS - 1 ? bit << 1 : 0);
+         }
+      }
+
+      /** Returns the slots of the specified orientation in conflict with a wall */
+      constexpr uint64_t get(Orientation wall, uint8_t slot, Orientation slots) const
+      {
+         return masks[static_cast<int>(wall)][static_cast<int>(slots)][slot];
+      }
+   };
+
+   constexpr WallConflicts WALL_CONFLICTS{};
+
+   /**
+    * Compact representation of the board, always in absolute coordinates (player 0's perspective).
+    *
+    * Walls are kept as one bitset per orientation, indexed by the slot of the wall's middle point
+    * (row * WALL_SLOTS + column). Pawns are kept as square indexes (row * BOARD_SIZE + column).
+    * The structure is trivially copyable and none of the queries allocate memory.
+    */
+   class QCODE_API BitBoard
+   {
+      // Encapsulated data members
+   private:
+
+      /** Occupied wall slots, indexed by Orientation */
+      uint64_t mWalls[2];
+
+      /** Square of each pawn, NO_SQUARE for missing players */
+      uint8_t mPawns[MAX_PLAYERS];
+
+      /** Initial state of each player. Defines the side of the board the player must reach. */
+      Direction mInitialStates[MAX_PLAYERS];
+
+      // Methods
+   public:
+
+      /** Construction of an empty board */
+      BitBoard();
+
+      /** Converts between positions and square indexes */
+      static uint8_t square(const Position& p) { return uint8_t(p.x * BOARD_SIZE + p.y); }
+      static Position position(uint8_t square) { return Position(square / BOARD_SIZE, square % BOARD_SIZE); }
+
+      /** Checks if the position is inside board's boundaries */
+      static bool isOnBoard(const Position& p) { return p.x >= 0 and p.y >= 0 and p.x < BOARD_SIZE and p.y < BOARD_SIZE; }
+
+      /** Checks if the wall is inside board's boundaries */
+      static bool isWallOnBoard(const WallState& w);
+
+      /** Returns the slot of a wall that is inside board's boundaries */
+      static uint8_t wallSlot(const WallState& w);
+
+      /** Checks if the position is on the side of the board that must be reached by the player */
+      static bool isGoal(const Position& p, Direction initialState);
+
+      /** Adds a player on the board */
+      void setPlayer(PlayerId id, const Position& p, Direction initialState);
+
+      /** Moves a pawn to the specified position */
+      void movePawn(PlayerId id, const Position& p) { mPawns[id] = square(p); }
+
+      /** Returns the position of a pawn */
+      Position getPawn(PlayerId id) const { return position(mPawns[id]); }
+
+      /** Returns the initial state of a player */
+      Direction getInitialState(PlayerId id) const { return mInitialStates[id]; }
+
+      /** Checks if the specified position is occupied by a pawn */
+      bool isPawn(const Position& p) const;
+
+      /** Returns the bitset of occupied wall slots for the specified orientation */
+      uint64_t getWalls(Orientation o) const { return mWalls[static_cast<int>(o)]; }
+
+      /** Checks if the wall overlaps or crosses a wall already placed */
+      bool isWallIntersecting(const WallState& w) const;
+
+      /** Returns the bitset of the slots where a wall of the specified orientation intersects no wall already placed */
+      uint64_t getFreeWallSlots(Orientation o) const;
+
+      /** Places a wall. Walls outside board's boundaries are ignored. */
+      void placeWall(const WallState& w);
+
+      /** Removes a wall placed before */
+      void removeWall(Orientation o, uint8_t slot) { mWalls[static_cast<int>(o)] &= ~(uint64_t(1) << slot); }
+
+      /** Checks if a step from the specified position in the specified direction is blocked by a wall or the board's edge */
+      bool isBlocked(const Position& p, Direction d) const;
+
+      /** Checks if the player can still reach its goal. Pawns don't block the path. */
+      bool hasPathToGoal(PlayerId id) const;
+
+   private:
+
+      /** Checks a wall slot, ignoring slots outside board's boundaries */
+      bool hasWall(Orientation o, int row, int column) const;
+   };
+}
+
+#endif // Header_qcore_BitBoard
@@ -0,0 +1,85 @@
+#ifndef Header_qcore_BoardHistory
+#define Header_qcore_BoardHistory
+
+#include "Qcore_API.h"
+#include "PlayerAction.h"
+#include "BoardSnapshot.h"
+
+#include <vector>
+#include <memory>
+
+namespace qcore
+{
+   /** Number of actions between two boards kept by a history */
+   const size_t HISTORY_CHECKPOINT_INTERVAL = 16;
+
+   /**
+    * Persistent history of the actions of a game. Each entry stores one action and shares all the
+    * previous ones with the history it was made from, so keeping the history after every action
+    * takes O(actions) memory in total. A board is kept every HISTORY_CHECKPOINT_INTERVAL actions,
+    * the other ones are rebuilt from the closest one. Histories are immutable, so they can be read
+    * from any thread.
+    */
+   class QCODE_API BoardHistory
+   {
+      // Type definitions
+   private:
+
+      struct Node
+      {
+         /** Previous entries, shared with the other histories */
+         std::shared_ptr<Node> previous;
+
+         /** Action made, in absolute coordinates */
+         PlayerAction action;
+
+         /** Number of actions up to this one */
+         size_t length;
+
+         /** Board after the action, kept only on checkpoints */
+         BoardSnapshotPtr board;
+
+         /** Destruction. Releases the unshared previous entries iteratively, long histories would overflow the stack. */
+         ~Node();
+      };
+
+      // Encapsulated data members
+   private:
+
+      uint8_t mNumberOfPlayers;
+
+      /** Last entry, null if no action was made */
+      std::shared_ptr<Node> mHead;
+
+      // Methods
+   public:
+
+      /** Construction of an empty history */
+      explicit BoardHistory(uint8_t players);
+
+      uint8_t getNumberOfPlayers() const { return mNumberOfPlayers; }
+
+      /** Returns the number of actions */
+      size_t size() const { return mHead ? mHead->length : 0; }
+
+      /** Returns the last action, in absolute coordinates. The history must not be empty. */
+      const PlayerAction& getLastAction() const { return mHead->action; }
+
+      /**
+       * Returns a new history with the action added, in absolute coordinates. The board after the
+       * action is kept if it is a checkpoint, and rebuilt otherwise if null.
+       */
+      BoardHistory push(const PlayerAction& action, BoardSnapshotPtr board = nullptr) const;
+
+      /** Returns the history of the first actions. Throws if longer than this history. */
+      BoardHistory getPrefix(size_t length) const;
+
+      /** Returns all the actions, in absolute coordinates */
+      std::vector<PlayerAction> getActions() const;
+
+      /** Returns the board after the last action, rebuilt from the closest checkpoint */
+      BoardSnapshotPtr getSnapshot() const;
+   };
+}
+
+#endif // Header_qcore_BoardHistory
@@ -0,0 +1,137 @@
+#ifndef Header_qcore_BoardSnapshot
+#define Header_qcore_BoardSnapshot
+
+#include "Qcore_API.h"
+#include "PlayerAction.h"
+#include "BitBoard.h"
+#include "DistanceMap.h"
+
+#include <vector>
+#include <memory>
+
+namespace qcore
+{
+   /**
+    * Immutable state of the board at a given moment. A new snapshot is published by the BoardState
+    * after every change, so a snapshot can be read from any thread without locking.
+    */
+   class QCODE_API BoardSnapshot
+   {
+      friend class BoardState;
+      friend class GameReplay;
+      friend class BoardHistory;
+
+      // Encapsulated data members
+   private:
+
+      /** Incremented on every change of the board */
+      uint32_t mVersion;
+
+      /** List of players and their position */
+      std::vector<PlayerState> mPlayers;
+
+      /** Walls from the perspective of each player, rotated once when the snapshot is built */
+      std::vector<std::vector<WallState>> mWallViews;
+
+      /** Players from the perspective of each player, rotated once when the snapshot is built */
+      std::vector<std::vector<PlayerState>> mPlayerViews;
+
+      /** Flags if the game has finished */
+      bool mFinished;
+
+      /** The player who won */
+      PlayerId mWinner;
+
+      /** Last action made */
+      PlayerAction mLastAction;
+
+      /** Compact representation of walls and pawns, kept in sync with the lists above */
+      BitBoard mBitBoard;
+
+      /** Distance to goal of each player, updated on every wall placement */
+      std::vector<DistanceMap> mDistances;
+
+      /** Zobrist hash of the position, updated on every action */
+      uint64_t mHash;
+
+      // Methods
+   public:
+
+      /** Construction of the initial board */
+      BoardSnapshot(uint8_t players, uint8_t walls = 0);
+
+      /** Returns the version of the board. Each change produces a new version. */
+      uint32_t getVersion() const { return mVersion; }
+
+      //
+      // Getters over different board information
+      // All information are from the perspective of the player set as parameter.
+      //
+
+      /** Get wall states */
+      const std::vector<WallState>& getWalls(const PlayerId id) const { return mWallViews.at(id); }
+
+      /** Get player states */
+      const std::vector<PlayerState>& getPlayers(const PlayerId id) const { return mPlayerViews.at(id); }
+
+      /** Check if the specified space is occupied by a pawn */
+      bool isSpaceEmpty(const Position& position, const PlayerId id) const;
+
+      /** Returns the number of walls left for the specified player */
+      uint8_t getWallsLeft(const PlayerId id) const { return mPlayers.at(id).wallsLeft; }
+
+      /** Returns the compact board representation, in absolute coordinates */
+      const BitBoard& getBitBoard() const { return mBitBoard; }
+
+      /** Returns the number of steps the player needs to reach its goal, ignoring other pawns */
+      uint8_t getGoalDistance(const PlayerId player) const;
+
+      /** Returns the number of steps from the specified position to player's goal, ignoring other pawns */
+      uint8_t getGoalDistance(const PlayerId player, const Position& position, const PlayerId id) const;
+
+      /** Returns the distances to goal of the specified player, in absolute coordinates */
+      const DistanceMap& getDistanceMap(const PlayerId player) const { return mDistances.at(player); }
+
+      /** Flags if the game has finished */
+      bool isFinished() const { return mFinished; }
+
+      /** Returns the ID of the player who won the game. Valid only when the game has finished. */
+      PlayerId getWinner() const { return mWinner; }
+
+      /** Returns the last action made */
+      PlayerAction getLastAction() const { return mLastAction; }
+
+      /**
+       * Returns the Zobrist hash of the position, with the player following the last action on move.
+       * Equal to the hash of a SearchState built from this snapshot.
+       */
+      uint64_t getHash() const { return mHash; }
+
+      /** Appends the compact binary form of the board: players and walls only, in absolute coordinates */
+      void encode(std::vector<uint8_t>& data) const;
+
+      /** Rebuilds a board from its compact binary form. The derived views are recomputed. */
+      static std::shared_ptr<BoardSnapshot> decode(const uint8_t* data, size_t size);
+
+   private:
+
+      /** Sets the specified action on the board, after it has been validated. Replays don't log the actions. */
+      void applyAction(const PlayerAction& action, bool log = true);
+
+      /** Sets an action of a replayed game, in absolute coordinates. The action isn't validated nor logged. */
+      void replayAction(const PlayerAction& action);
+
+      /** Force game termination */
+      void endGame();
+
+      /** Rotates all players for each perspective */
+      void updatePlayerViews();
+
+      /** Computes the hash of the whole position */
+      void updateHash(PlayerId currentPlayer);
+   };
+
+   typedef std::shared_ptr<const BoardSnapshot> BoardSnapshotPtr;
+}
+
+#endif // Header_qcore_BoardSnapshot
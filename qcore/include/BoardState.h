@@ -3,6 +3,7 @@
 
 #include "Qcore_API.h"
 #include "PlayerAction.h"
+#include "BoardSnapshot.h"
 
 #include <list>
 #include <vector>
@@ -65,25 +66,13 @@ namespace qcore
       // Encapsulated data members
    private:
 
-      /** List of walls placed on the board */
-      std::list<WallState> mWalls;
-
-      /** List of players and their position */
-      std::vector<PlayerState> mPlayers;
-
-      /** Flags if the game has finished */
-      bool mFinished;
-
-      /** The player who won */
-      PlayerId mWinner;
-
-      /** Last action made */
-      PlayerAction mLastAction;
+      /** Current state of the board. Replaced (never modified) on every change. */
+      BoardSnapshotPtr mSnapshot;
 
       /** List of state change callbacks */
       mutable std::list<StateChangeCb> mStateChangeCb;
 
-      /** Protection against concurrent access */
+      /** Serializes board updates. Readers only load the current snapshot. */
       mutable std::mutex mMutex;
 
       // Methods
@@ -92,21 +81,24 @@ namespace qcore
       /** Construction */
       BoardState(uint8_t players, uint8_t walls = 0);
 
+      /** Construction over an existing snapshot, without any state change callbacks */
+      explicit BoardState(BoardSnapshotPtr snapshot);
+
       BoardState(const BoardState& bs) :
-          mWalls(bs.mWalls),
-          mPlayers(bs.mPlayers),
-          mFinished(bs.mFinished),
-          mWinner(bs.mWinner),
-          mLastAction(bs.mLastAction),
+          mSnapshot(bs.getSnapshot()),
           mStateChangeCb(bs.mStateChangeCb)
       {};
 
       /** Registers callback for state change notification */
       void registerStateChange(StateChangeCb cb) const;
 
+      /** Returns the current snapshot of the board. It remains valid and unchanged after later updates. */
+      BoardSnapshotPtr getSnapshot() const;
+
       //
       // Getters over different board information
       // All information are from the perspective of the player set as parameter.
+      // The getters return copies; use the snapshot for direct access to the cached views.
       //
 
       /** Get wall states */
@@ -118,6 +110,21 @@ namespace qcore
       /** Check if the specified space is occupied by a pawn */
       bool isSpaceEmpty(const Position& position, const PlayerId id) const;
 
+      /** Returns the number of walls left for the specified player */
+      uint8_t getWallsLeft(const PlayerId id) const;
+
+      /** Returns the compact board representation, in absolute coordinates */
+      BitBoard getBitBoard() const;
+
+      /** Returns the number of steps the player needs to reach its goal, ignoring other pawns */
+      uint8_t getGoalDistance(const PlayerId player) const;
+
+      /** Returns the number of steps from the specified position to player's goal, ignoring other pawns */
+      uint8_t getGoalDistance(const PlayerId player, const Position& position, const PlayerId id) const;
+
+      /** Returns the distances to goal of the specified player, in absolute coordinates */
+      DistanceMap getDistanceMap(const PlayerId player) const;
+
       /** Flags if the game has finished */
       bool isFinished() const;
 
@@ -127,6 +134,9 @@ namespace qcore
       /** Returns the last action made */
       PlayerAction getLastAction() const;
 
+      /** Returns the Zobrist hash of the position */
+      uint64_t getHash() const;
+
       /**
        * Creates a matrix representing the elements on the board. Between 'pawn' rows / columns are
        * inserted 'wall' rows / columns, therefore the map size will be BOARD_SIZE * 2 - 1.
@@ -144,8 +154,16 @@ namespace qcore
       /** Force game termination */
       void endGame();
 
+      /** Replaces the whole board, with a snapshot received from a remote game */
+      void load(BoardSnapshotPtr snapshot);
+
       /** Notifies all listeners that the board state has changed */
       void notifyStateChange() const;
+
+   private:
+
+      /** Makes the new snapshot visible to all readers */
+      void publish(BoardSnapshotPtr snapshot);
    };
 
    typedef std::shared_ptr<const BoardState> BoardStatePtr;
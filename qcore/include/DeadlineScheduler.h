@@ -0,0 +1,86 @@
+#ifndef Header_qcore_DeadlineScheduler
+#define Header_qcore_DeadlineScheduler
+
+#include "Qcore_API.h"
+
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <unordered_map>
+#include <memory>
+
+namespace qcore
+{
+   /**
+    * Runs callbacks when their deadline expires, on a single thread. The thread sleeps until the
+    * earliest deadline, or until a new earlier deadline is scheduled, so an idle scheduler costs no CPU.
+    */
+   class QCODE_API DeadlineScheduler
+   {
+      // Type definitions
+   public:
+
+      typedef std::chrono::steady_clock Clock;
+      typedef uint64_t TimerId;
+      typedef std::function<void()> Callback;
+
+      /** Never returned by schedule() */
+      static const TimerId INVALID_TIMER = 0;
+
+      // Encapsulated data members
+   private:
+
+      /** Pending callbacks, ordered by deadline */
+      std::map<std::pair<Clock::time_point, TimerId>, Callback> mTimers;
+
+      /** Deadline of each pending timer */
+      std::unordered_map<TimerId, Clock::time_point> mDeadlines;
+
+      /** ID of the next scheduled timer */
+      TimerId mNextId;
+
+      /** Set on destruction, to stop the thread */
+      bool mStopped;
+
+      /** Protection against concurrent access */
+      std::mutex mMutex;
+      std::condition_variable mCv;
+
+      /** Thread running the callbacks */
+      std::thread mThread;
+
+      // Methods
+   public:
+
+      /** Construction */
+      DeadlineScheduler();
+
+      /** Destruction. Pending callbacks are dropped. */
+      ~DeadlineScheduler();
+
+      DeadlineScheduler(const DeadlineScheduler&) = delete;
+      DeadlineScheduler& operator=(const DeadlineScheduler&) = delete;
+
+      /** Returns the scheduler shared by all games of the process */
+      static std::shared_ptr<DeadlineScheduler> Shared();
+
+      /** Schedules a callback to be called once the deadline expires */
+      TimerId schedule(Clock::time_point deadline, Callback callback);
+
+      /**
+       * Cancels a pending callback
+       * @return false if the callback was already called, or is running
+       */
+      bool cancel(TimerId timer);
+
+   private:
+
+      /** Scheduler thread loop */
+      void run();
+   };
+}
+
+#endif // Header_qcore_DeadlineScheduler
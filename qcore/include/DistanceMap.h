@@ -0,0 +1,48 @@
+#ifndef Header_qcore_DistanceMap
+#define Header_qcore_DistanceMap
+
+#include "Qcore_API.h"
+#include "BitBoard.h"
+
+namespace qcore
+{
+   /**
+    * Distance from every square of the board to the goal side of one player, in absolute coordinates.
+    * Pawns are not considered obstacles. Since walls can only be added, distances can only grow and
+    * the map is updated incrementally, re-relaxing only the squares affected by the new wall.
+    */
+   class QCODE_API DistanceMap
+   {
+      // Type definitions
+   public:
+
+      /** Distance of the squares from which the goal cannot be reached */
+      static const uint8_t UNREACHABLE = 0xFF;
+
+      // Encapsulated data members
+   private:
+
+      /** Distance to goal, indexed by square */
+      uint8_t mDist[BOARD_SQUARES];
+
+      /** Initial state of the player. Defines the goal side. */
+      Direction mInitialState;
+
+      // Methods
+   public:
+
+      /** Construction. All squares are unreachable until reset. */
+      DistanceMap();
+
+      /** Recomputes all distances for the specified board */
+      void reset(const BitBoard& board, Direction initialState);
+
+      /** Updates the distances after the specified wall was placed on the board */
+      void update(const BitBoard& board, const WallState& wall);
+
+      /** Returns the distance from the specified position to the goal */
+      uint8_t get(const Position& p) const { return BitBoard::isOnBoard(p) ? mDist[BitBoard::square(p)] : UNREACHABLE; }
+   };
+}
+
+#endif // Header_qcore_DistanceMap
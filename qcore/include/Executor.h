@@ -0,0 +1,44 @@
+#ifndef Header_qcore_Executor
+#define Header_qcore_Executor
+
+#include "Qcore_API.h"
+
+#include <functional>
+#include <memory>
+#include <cstdint>
+
+namespace qcore
+{
+   /**
+    * Runs tasks asynchronously. Implementations decide on which thread and when.
+    */
+   class QCODE_API Executor
+   {
+      // Type definitions
+   public:
+
+      typedef std::function<void()> Task;
+
+      /** Task may run on any thread */
+      static const size_t NO_AFFINITY = SIZE_MAX;
+
+      // Methods
+   public:
+
+      /** Destruction */
+      virtual ~Executor() = default;
+
+      /**
+       * Queues a task. The affinity is only a hint: tasks with the same affinity prefer to run
+       * on the same thread, as long as it doesn't keep them waiting while other threads are idle.
+       */
+      virtual void post(Task task, size_t affinity = NO_AFFINITY) = 0;
+
+      /** Returns the maximum number of tasks running in parallel */
+      virtual size_t getConcurrency() const = 0;
+   };
+
+   typedef std::shared_ptr<Executor> ExecutorPtr;
+}
+
+#endif // Header_qcore_Executor
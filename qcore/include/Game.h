@@ -4,10 +4,14 @@
 #include "Qcore_API.h"
 #include "PlayerAction.h"
 #include "BoardState.h"
+#include "BoardHistory.h"
+#include "Protocol.h"
 
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
+#include <functional>
+#include <vector>
 
 namespace qcore
 {
@@ -24,6 +28,15 @@ namespace qcore
       /** Pointer to the game server */
       std::shared_ptr<GameServer> mGameServer;
 
+      /** ID of the game on the game server */
+      GameId mGameId;
+
+      /** Called after each valid move and when the game ends */
+      std::function<void()> mMoveListener;
+
+      /** Actions applied since the start of the game. Shared by the copies of the game. */
+      BoardHistory mHistory;
+
    protected:
 
       /** Keeps the current state of the game */
@@ -48,8 +61,11 @@ namespace qcore
 
       virtual ~Game() = default;
 
-      /** Sets the game server */
-      void setGameServer(std::shared_ptr<GameServer> gameServer);
+      /** Sets the game server hosting the game, and the game ID on the server */
+      void setGameServer(std::shared_ptr<GameServer> gameServer, GameId gameId);
+
+      /** Sets the function called after each valid move and when the game ends, from the thread making the change */
+      void setMoveListener(std::function<void()> listener);
 
       /** Returns the number of players in the game */
       uint8_t getNumberOfPlayers() const { return mNumberOfPlayers; }
@@ -60,6 +76,15 @@ namespace qcore
       /** Returns the ID of the player on move */
       PlayerId getCurrentPlayer() const;
 
+      /** Returns the actions applied since the start of the game, in absolute coordinates */
+      std::vector<PlayerAction> getActions() const;
+
+      /** Returns the history of the game. It remains unchanged after later actions. */
+      BoardHistory getHistory() const;
+
+      /** Restarts the game from the end of the specified history, with the next player on move */
+      void load(const BoardHistory& history);
+
       /** Waits until the specified player has picked his move */
       void waitPlayerMove(PlayerId playerId);
       void waitPlayerMoveUntil(PlayerId playerId, std::chrono::steady_clock::time_point until);
@@ -76,8 +101,8 @@ namespace qcore
 
    private:
 
-      /** Checks if the player's path isn't blocked */
-      bool checkPlayerPath(const PlayerId playerId, const PlayerAction& action) const;
+      /** Checks if the player's path isn't blocked on the board with the new wall placed */
+      bool checkPlayerPath(const PlayerId playerId, const BitBoard& board) const;
 
       void nextPlayer();
 
@@ -4,11 +4,18 @@
 #include "Qcore_API.h"
 #include "Player.h"
 #include "BoardState.h"
+#include "BoardHistory.h"
+#include "TimeControl.h"
+#include "DeadlineScheduler.h"
+#include "Executor.h"
+#include "Protocol.h"
+#include "GameRecord.h"
 
 #include <string>
 #include <map>
 #include <memory>
-#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <chrono>
 
 namespace qcore
@@ -24,6 +31,14 @@ namespace qcore
       std::string ip;
    };
 
+   /** Game hosted by a game server */
+   struct GameInfo
+   {
+      GameId id;
+      std::string name;
+      uint8_t numberOfPlayers;
+   };
+
    class QCODE_API GameController
    {
       // Encapsulated data members
@@ -35,23 +50,66 @@ namespace qcore
       /** List of players for the current game */
       std::map<PlayerId, std::shared_ptr<Player>> mPlayers;
 
-      /** Thread handling player operations */
-      std::thread mPlayerThread;
-
-      /** Watchdog */
-      std::thread mWatchThread;
-
       /** Handles remote operations */
       std::shared_ptr<GameServer> mGameServer;
 
+      /** ID of the game hosted on the game server, if any */
+      GameId mHostedGameId;
+
       /** Timestamp of the last action start */
       std::chrono::steady_clock::time_point mActionTs;
 
+      /** Minimum duration of a move, to keep the game watchable */
+      std::chrono::milliseconds mMinMoveTime;
+
+      /** Time allowed to the players without a time control of their own */
+      TimeControl mDefaultTimeControl;
+
+      /** Time allowed to specific players */
+      std::map<PlayerId, TimeControl> mTimeControls;
+
+      /** Thinking time left for each player of the current game */
+      std::map<PlayerId, PlayerClock> mClocks;
+
+      /** Runs player moves */
+      ExecutorPtr mExecutor;
+
+      /** Affinity of player moves on the executor */
+      size_t mAffinity;
+
+      /** Records the games started by start(), once finished */
+      GameRecordWriterPtr mRecordWriter;
+
+      /** Watchdog and move delays. Ends the game when the player on move runs out of time. */
+      std::shared_ptr<DeadlineScheduler> mScheduler;
+
+      /** Deadline of the move in progress */
+      DeadlineScheduler::TimerId mTimer;
+
+      /** Player making the move in progress */
+      PlayerId mMovingPlayer;
+
       /** Waiting for a player to make a decision */
       bool mMoveInProgress;
 
+      /** Player who lost the game by exceeding his time, 0xFF if none */
+      PlayerId mTimedOutPlayer;
+
+      /** Number of player moves posted to the executor and not returned yet */
+      uint32_t mPendingMoves;
+
+      /** Flags if the game started by start() is still running */
+      bool mRunning;
+
+      /** Stop after the move in progress */
+      bool mOneStep;
+
+      /** Players may take as long as they need */
+      bool mWatchdogDisabled;
+
       /** Protection against concurrent access */
       std::mutex mMutex;
+      std::condition_variable mFinishedCv;
 
       /** Specifies if the game is running on a remote server */
       bool mIsRemoteGame;
@@ -62,13 +120,33 @@ namespace qcore
       /** Construction */
       GameController(const std::string& configFile = "quoridor.ini");
 
-      /** Initializes a new remote game */
+      /** Destruction. Ends the running game. */
+      ~GameController();
+
+      /** Initializes a new remote game, hosted as the first game of a server of its own */
       void startServer(const std::string& serverName, uint8_t numberOfPlayers = 2);
 
+      /**
+       * Initializes a new remote game, hosted on a server shared with other controllers. The server
+       * must have been started by its owner.
+       * @return the ID clients use to join the game
+       */
+      GameId hostGame(std::shared_ptr<GameServer> server, const std::string& gameName, uint8_t numberOfPlayers = 2);
+
       /** Starts network discovery and returns the list of IPs where game servers are running */
       std::list<Endpoint> discoverRemoteGames();
 
-      void connectToRemoteGame(const std::string& ip);
+      /** Lists the games hosted by a game server */
+      std::list<GameInfo> listRemoteGames(const std::string& ip);
+
+      /** Connects to a game hosted by a remote server */
+      void connectToRemoteGame(const std::string& ip, GameId gameId = 0);
+
+      /** Connects to a remote game as a spectator. Board updates are grouped at the interval, if not zero. */
+      void spectateRemoteGame(
+         const std::string& ip,
+         std::chrono::milliseconds batchInterval = std::chrono::milliseconds(0),
+         GameId gameId = 0);
 
       /** Initializes a new local game */
       void initLocalGame(uint8_t numberOfPlayers = 2);
@@ -79,9 +157,30 @@ namespace qcore
       /** Adds a player running on a remote machine */
       PlayerId addRemotePlayer(std::shared_ptr<RemoteSession> client, const std::string& playerName);
 
-      /** Starts the game */
+      /** Asks a local player of a remote game for his next move, on the executor */
+      void notifyRemoteMove(PlayerId playerId);
+
+      /** Sets the minimum duration of a move. Quicker moves are delayed to keep the game watchable. */
+      void setMinMoveTime(std::chrono::milliseconds minMoveTime);
+
+      /** Sets the time allowed to all players, except the ones with a time control of their own */
+      void setTimeControl(const TimeControl& timeControl);
+
+      /** Sets the time allowed to the specified player. Resets player's clock. */
+      void setTimeControl(PlayerId playerId, const TimeControl& timeControl);
+
+      /** Sets the executor running player moves. Moves of this controller's games prefer the worker given by the affinity. */
+      void setExecutor(ExecutorPtr executor, size_t affinity = Executor::NO_AFFINITY);
+
+      /** Records the games started by start() to the writer once finished. Null stops recording. */
+      void setRecordWriter(GameRecordWriterPtr writer);
+
+      /** Starts the game. Player moves are run by the executor, the call doesn't block. */
       void start(bool oneStep = false);
 
+      /** Blocks until the game started by start() has ended and all players returned from their last move */
+      void waitFinished();
+
       /** Returns the current game state */
       BoardStatePtr getBoardState() const;
 
@@ -97,6 +196,9 @@ namespace qcore
       const Game exportGame() const;
       void loadGame(const Game& game);
 
+      /** Restarts the game from the end of the specified history, with the next player on move */
+      void loadGame(const BoardHistory& history);
+
       //
       // Perform actions for the current player. Positions / Directions are relative to the player 0.
       //
@@ -104,6 +206,23 @@ namespace qcore
       bool moveCurrentPlayer(Direction direction);
       bool moveCurrentPlayer(Position position);
       bool placeWallForCurrentPlayer(Position position, Orientation orientation);
+
+   private:
+
+      /** Asks the player on move for his next move, or marks the end of the game */
+      void requestMove();
+
+      /** Called when the player on move has made his move, or when the game ended */
+      void onMoveDone();
+
+      /** Returns the clock of the specified player, started with his time control if needed */
+      PlayerClock& getClock(PlayerId playerId);
+
+      /** Stops hosting the current game on the game server, and disconnects its clients */
+      void removeHostedGame();
+
+      /** Ends the local game started by start(), waits for its players and stops listening to its moves */
+      void stopGame();
    };
 }
 
@@ -0,0 +1,166 @@
+#ifndef Header_qcore_GameRecord
+#define Header_qcore_GameRecord
+
+#include "Qcore_API.h"
+#include "PlayerAction.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <memory>
+
+namespace qcore
+{
+   // Forward declaration
+   class Game;
+
+   /**
+    * Game record files start with GAME_RECORD_MAGIC, followed by the games one after the other.
+    * Each game has a header of GAME_RECORD_HEADER_SIZE bytes: number of players, winner (0xFF
+    * if none; the opponent of a player who lost a 2 player game on time), two reserved bytes and
+    * the number of actions (32-bit, little endian). The actions follow, packed by
+    * PlayerAction::pack() in 16 bits (little endian), in absolute coordinates.
+    */
+   const char GAME_RECORD_MAGIC[4] = { 'Q', 'G', 'R', 1 };
+   const size_t GAME_RECORD_HEADER_SIZE = 8;
+   const size_t GAME_RECORD_ACTION_SIZE = 2;
+
+   /** A game of a record file. Data is owned by the GameRecordReader. */
+   class QCODE_API GameRecordView
+   {
+      // Encapsulated data members
+   private:
+
+      const uint8_t* mData;
+
+      // Methods
+   public:
+
+      /** Construction, from the header of the game */
+      explicit GameRecordView(const uint8_t* data = nullptr) : mData(data) {}
+
+      uint8_t getNumberOfPlayers() const { return mData[0]; }
+
+      /** Returns the player who won, 0xFF if the game ended without a winner */
+      PlayerId getWinner() const { return mData[1]; }
+
+      uint32_t getNumberOfActions() const;
+
+      /** Returns the specified action, in absolute coordinates */
+      PlayerAction getAction(uint32_t index) const;
+
+      /** Returns the size of the game in the file */
+      size_t getSize() const { return GAME_RECORD_HEADER_SIZE + getNumberOfActions() * GAME_RECORD_ACTION_SIZE; }
+   };
+
+   /**
+    * Appends finished games to a record file. The games are written at once, so a crash loses at
+    * most the games being written. Can be shared by games running in parallel.
+    */
+   class QCODE_API GameRecordWriter
+   {
+      // Encapsulated data members
+   private:
+
+      std::ofstream mFile;
+
+      /** Protection against concurrent access */
+      std::mutex mMutex;
+
+      // Methods
+   public:
+
+      /** Construction. Creates the file, or opens it for append. Throws if it isn't a record file. */
+      explicit GameRecordWriter(const std::string& path);
+
+      /** Appends a game, with the actions applied until now and the winner on the board. Games lost on time need the winner. */
+      void append(const Game& game);
+
+      /** Appends a game */
+      void append(uint8_t numberOfPlayers, PlayerId winner, const std::vector<PlayerAction>& actions);
+   };
+
+   typedef std::shared_ptr<GameRecordWriter> GameRecordWriterPtr;
+
+   /**
+    * Reads a record file mapped in memory. Games are iterated in place, without copying or parsing
+    * the file. The file must not be truncated while it's being read.
+    */
+   class QCODE_API GameRecordReader
+   {
+      // Type definitions
+   public:
+
+      /** Iterates over the games of the file. Throws if the next game is truncated. */
+      class QCODE_API Iterator
+      {
+         // Type definitions
+      public:
+
+         typedef std::forward_iterator_tag iterator_category;
+         typedef GameRecordView value_type;
+         typedef std::ptrdiff_t difference_type;
+         typedef const GameRecordView* pointer;
+         typedef const GameRecordView& reference;
+
+         // Encapsulated data members
+      private:
+
+         GameRecordView mGame;
+         const uint8_t* mPosition;
+         const uint8_t* mEnd;
+
+         // Methods
+      public:
+
+         /** Construction, at the specified position in the file data */
+         Iterator(const uint8_t* position, const uint8_t* end);
+
+         reference operator*() const { return mGame; }
+         pointer operator->() const { return &mGame; }
+
+         Iterator& operator++();
+
+         bool operator==(const Iterator& other) const { return mPosition == other.mPosition; }
+         bool operator!=(const Iterator& other) const { return mPosition != other.mPosition; }
+
+      private:
+
+         /** Checks the game at the current position */
+         void load();
+      };
+
+      // Encapsulated data members
+   private:
+
+      /** File data, mapped in memory */
+      const uint8_t* mData;
+      size_t mSize;
+
+      // Methods
+   public:
+
+      /** Construction. Maps the file in memory. Throws if it isn't a record file. */
+      explicit GameRecordReader(const std::string& path);
+
+      /** Destruction. Unmaps the file. */
+      ~GameRecordReader();
+
+      GameRecordReader(const GameRecordReader&) = delete;
+      GameRecordReader& operator=(const GameRecordReader&) = delete;
+
+      Iterator begin() const;
+      Iterator end() const;
+
+   private:
+
+      /** Releases the memory mapping */
+      void unmap();
+   };
+}
+
+#endif // Header_qcore_GameRecord
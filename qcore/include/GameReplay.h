@@ -0,0 +1,82 @@
+#ifndef Header_qcore_GameReplay
+#define Header_qcore_GameReplay
+
+#include "Qcore_API.h"
+#include "PlayerAction.h"
+#include "BoardSnapshot.h"
+
+#include <vector>
+#include <memory>
+
+namespace qcore
+{
+   // Forward declarations
+   class Game;
+   class GameRecordView;
+
+   /** Number of actions between two checkpoints of a replay */
+   const size_t DEFAULT_REPLAY_CHECKPOINT_INTERVAL = 16;
+
+   /**
+    * Replays a played game. Actions are applied directly on the board, without validation or
+    * logging, since they were validated when the game was played. A copy of the board is kept
+    * every few actions, so seeking to any position applies at most checkpointInterval actions.
+    * Not thread safe.
+    */
+   class QCODE_API GameReplay
+   {
+      // Encapsulated data members
+   private:
+
+      uint8_t mNumberOfPlayers;
+
+      /** Actions of the game, in absolute coordinates */
+      std::vector<PlayerAction> mActions;
+
+      /** Number of actions between two checkpoints */
+      size_t mCheckpointInterval;
+
+      /** Board after every mCheckpointInterval actions. Added the first time the position is reached. */
+      std::vector<BoardSnapshotPtr> mCheckpoints;
+
+      /** Board at the current position. Copied before a change if it is shared. */
+      std::shared_ptr<BoardSnapshot> mBoard;
+
+      /** Number of actions applied on the board */
+      size_t mPosition;
+
+      // Methods
+   public:
+
+      /** Construction, from the actions of a game in absolute coordinates */
+      GameReplay(uint8_t numberOfPlayers, std::vector<PlayerAction> actions, size_t checkpointInterval = DEFAULT_REPLAY_CHECKPOINT_INTERVAL);
+
+      /** Construction, from the actions applied on a game until now */
+      explicit GameReplay(const Game& game, size_t checkpointInterval = DEFAULT_REPLAY_CHECKPOINT_INTERVAL);
+
+      /** Construction, from a game of a record file */
+      explicit GameReplay(const GameRecordView& game, size_t checkpointInterval = DEFAULT_REPLAY_CHECKPOINT_INTERVAL);
+
+      uint8_t getNumberOfPlayers() const { return mNumberOfPlayers; }
+
+      /** Returns the number of actions of the game */
+      size_t getNumberOfActions() const { return mActions.size(); }
+
+      /** Returns the specified action, in absolute coordinates */
+      const PlayerAction& getAction(size_t index) const { return mActions.at(index); }
+
+      /** Returns the number of actions applied on the board */
+      size_t getPosition() const { return mPosition; }
+
+      /** Applies the next action. Returns false at the end of the game. */
+      bool next();
+
+      /** Moves to the board after the specified number of actions. Throws if past the end of the game. */
+      void seek(size_t position);
+
+      /** Returns the board at the current position. It remains unchanged when the replay moves. */
+      BoardSnapshotPtr getSnapshot() const { return mBoard; }
+   };
+}
+
+#endif // Header_qcore_GameReplay
@@ -5,7 +5,11 @@
 
 #include <string>
 #include <list>
+#include <map>
+#include <deque>
 #include <thread>
+#include <vector>
+#include <mutex>
 
 #include <boost/bind.hpp>
 #include <boost/asio.hpp>
@@ -13,6 +17,8 @@
 
 #include "Qcore_API.h"
 #include "GameController.h"
+#include "Game.h"
+#include "Protocol.h"
 
 namespace qcore
 {
@@ -22,7 +28,17 @@ namespace qcore
    const char * const CLIENT_ID = "2e49f8b8-f09d-4d3a-b494-35d14768e551";
    const char * const SERVER_ID = "b767eacd-64b6-4bbd-9a38-b4788a94b1f7";
 
-   /** Manages a TCP connection to a client */
+   /** Clients with more unsent bytes than this are too slow to follow the game, and are disconnected */
+   const size_t MAX_SESSION_BACKLOG = 1024 * 1024;
+
+   /** Longest interval at which a spectator may ask to receive the board updates */
+   const uint16_t MAX_SPECTATOR_BATCH_MS = 10000;
+
+   /**
+    * Manages a TCP connection to a client. Messages are queued and written asynchronously by the IO
+    * threads, so senders never block on a slow client. After the handshake, the client joins one of
+    * the games hosted by the server, and its requests are routed to that game.
+    */
    class QCODE_API RemoteSession : public std::enable_shared_from_this<RemoteSession>
    {
       // Encapsulated data members
@@ -31,10 +47,37 @@ namespace qcore
       /** Reference to the parent */
       GameServer& mServer;
 
+      /** Serializes the handlers of the session, which may run on any IO thread */
+      boost::asio::io_service::strand mStrand;
+
       /** TCP Socket data */
       boost::asio::ip::tcp::socket mSocket;
-      boost::array<char, 1024> mRecvData;
-      std::string mRecvBuffer;
+      FrameReader mReader;
+
+      /** Set by the handshake. Used only by the session's strand. */
+      bool mIdentified;
+
+      /** Game joined by the client, INVALID_GAME_ID until then. Used only by the session's strand. */
+      GameId mGameId;
+
+      /** Frames waiting to be written, and their total size */
+      std::deque<FrameBuffer> mOutbound;
+      size_t mOutboundBytes;
+
+      /** Frames being written by the session's strand */
+      std::vector<FrameBuffer> mWriting;
+
+      /** Set while a write is in progress, or after the session was closed */
+      bool mWriteActive;
+      bool mClosed;
+
+      /** Batchable frames are held back and written together at this interval (spectators only) */
+      std::chrono::milliseconds mBatchInterval;
+      boost::asio::steady_timer mBatchTimer;
+      bool mBatchPending;
+
+      /** Protection of the outbound queue */
+      std::mutex mSendMutex;
 
       // Methods
    public:
@@ -48,16 +91,47 @@ namespace qcore
       /** Starts communication */
       void start();
 
-      /** Sends a message to the client */
-      void send(const std::string& message);
+      /** Returns the game joined by the client, or INVALID_GAME_ID */
+      GameId getGameId() const { return mGameId; }
+
+      /**
+       * Queues a message for the client. Doesn't block. Batchable frames may be held back until
+       * the next batch interval.
+       */
+      void send(uint8_t messageType, const uint8_t* data = nullptr, size_t size = 0);
+      void send(const FrameBuffer& frame, bool batch = false);
+
+      /** Sends the response to a client request. The status is 0 on success. */
+      void respond(RequestId requestId, uint8_t status, const std::string& data = std::string());
+
+      /** Sets the interval at which batchable frames are written. Zero writes them immediately. */
+      void setBatchInterval(std::chrono::milliseconds interval);
+
+      /** Closes the connection from any thread. Queued messages are dropped. */
+      void close(const std::string& reason);
 
    private:
 
+      /** Writes all queued frames at once. Runs on the session's strand. */
+      void startWrite();
+
+      /** Handles the end of a write */
+      void handleWrite(const boost::system::error_code& error);
+
+      /** Waits for the end of the batch interval. Runs on the session's strand. */
+      void startBatchTimer();
+
+      /** Writes the frames batched during the interval */
+      void handleBatchTimer(const boost::system::error_code& error);
+
+      /** Receives the next bytes directly into the frame reader */
+      void startRead();
+
       /** Handler socket read */
       void handleRead(const boost::system::error_code& error, size_t bytesTransferred);
 
-      /** Processes a received message */
-      void processMessage(const std::string& message);
+      /** Processes a received message. Throws if the message doesn't carry a request ID. */
+      void processMessage(const FrameView& frame);
    };
 
    typedef std::shared_ptr<RemoteSession> RemoteSessionPtr;
@@ -75,19 +149,31 @@ namespace qcore
          RequestPlayerNextMove,
          PlayerAction,
          BoardStateUpdate,
+         ValidateAction,
+         JoinSpectator,
+         ListGames,
+         JoinGame,
+      };
+
+      /** Game hosted by the server, and the clients which joined it */
+      struct HostedGame
+      {
+         GameController* controller;
+         GamePtr game;
+         std::string name;
+         std::list<RemoteSessionPtr> clients;
       };
 
       // Encapsulated data members
    private:
 
-      GameController& mGameController;
-
       std::string mServerName;
       std::list<Endpoint> mDiscoveredEndpoints;
 
+      /** IO service shared by all sessions, run by a pool of threads */
       boost::asio::io_service mIoService;
       boost::asio::io_service::work mIoServiceWork;
-      std::thread mIoServiceThread;
+      std::vector<std::thread> mIoThreads;
 
       boost::asio::ip::udp::socket mDiscoverySocket;
       boost::array<char, 1024> mDiscoveryRecvData;
@@ -99,14 +185,27 @@ namespace qcore
 
       boost::asio::ip::tcp::acceptor mAcceptor;
       std::list<RemoteSessionPtr> mClients;
+      std::mutex mClientsMutex;
+
+      /** Games hosted by the server */
+      std::map<GameId, HostedGame> mGames;
+      GameId mNextGameId;
+      std::mutex mGamesMutex;
+
+      /** Orders broadcasts and spectator snapshots, so every update is either in the snapshot or sent after it */
+      std::mutex mBroadcastMutex;
 
       // Methods
    public:
 
-      /** Construction */
-      GameServer(GameController& controller);
+      /**
+       * Construction. Starts the IO threads, by default as many as set by QUORIDOR_IO_THREADS, or
+       * one for each hardware thread.
+       */
+      GameServer(size_t ioThreads = 0);
 
-      GameController& getGameController() { return mGameController; }
+      /** Destruction. Stops the IO service and joins the IO threads. */
+      ~GameServer();
 
       void startServer(const std::string& serverName);
 
@@ -114,10 +213,44 @@ namespace qcore
 
       void removeClient(RemoteSessionPtr session);
 
-      void send(const std::string& message);
+      /**
+       * Hosts a game. The controller must remove the game before it's destroyed.
+       * @return the ID clients use to join the game
+       */
+      GameId addGame(GameController& controller, GamePtr game, const std::string& gameName);
+
+      /** Stops hosting a game and disconnects its clients */
+      void removeGame(GameId gameId);
+
+      /** Returns the games currently hosted */
+      std::list<GameInfo> listGames();
+
+      /** Adds a client to the game, which then receives its updates. Throws if the game isn't hosted. */
+      void joinGame(RemoteSessionPtr session, GameId gameId);
+
+      /** Returns a hosted game. Throws if the game isn't hosted. */
+      GamePtr getGame(GameId gameId);
+
+      /** Adds a player of the client to the game joined by the client */
+      PlayerId addRemotePlayer(RemoteSessionPtr session, const std::string& playerName);
+
+      /**
+       * Answers a spectator's join request with a snapshot of the board. All later updates follow
+       * the snapshot; the ones it already contains are recognized by their version.
+       */
+      void addSpectator(RemoteSessionPtr session, RequestId requestId, std::chrono::milliseconds batchInterval);
+
+      /** Returns the CPU time used so far by the IO threads */
+      std::chrono::nanoseconds getIoCpuTime();
+
+      /** Queues a message for all clients of a game. The frame is encoded once and shared by the clients. */
+      void send(GameId gameId, uint8_t messageType, const uint8_t* data, size_t size);
 
    private:
 
+      /** Returns a hosted game. Throws if the game isn't hosted. The games must be locked. */
+      HostedGame& findGame(GameId gameId);
+
       void broadcastDiscoverMessage();
 
       void startDiscoveryServer();
@@ -65,12 +65,24 @@ namespace qcore
       /** Returns the BoardState object */
       BoardStatePtr getBoardState() const;
 
+      /** Returns the current snapshot of the board. Cheaper than getBoardState(), nothing is copied. */
+      BoardSnapshotPtr getSnapshot() const;
+
       /** Returns player's position on the board */
       Position getPosition() const;
 
       /** Returns number of walls left for the current player */
       uint8_t getWallsLeft() const;
 
+      /** Returns the number of steps the current player needs to reach the goal, ignoring other pawns */
+      uint8_t getGoalDistance() const;
+
+      /** Returns the number of steps the specified player needs to reach its goal, ignoring other pawns */
+      uint8_t getGoalDistance(PlayerId playerId) const;
+
+      /** Returns the number of steps from the specified position to the goal of the specified player */
+      uint8_t getGoalDistance(PlayerId playerId, const Position& position) const;
+
       //
       // Player Actions
       // All coordinates must be set from the player's perspective (relative to the player's start).
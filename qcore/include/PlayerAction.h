@@ -71,7 +71,7 @@ namespace qcore
    struct QCODE_API WallState
    {
       Position position;
-      Orientation orientation;
+      Orientation orientation = Orientation::Vertical;
 
       /** Rotates all coordinates counterclockwise for a number of steps */
       WallState rotate(const uint8_t rotations) const;
@@ -101,6 +101,24 @@ namespace qcore
       /** Rotates all coordinates counterclockwise for a number of steps */
       PlayerAction rotate(const uint8_t rotations) const;
 
+      /** Size of the fixed-layout binary record */
+      static const size_t ENCODED_SIZE = 7;
+
+      /** Writes the fixed-layout binary record (ENCODED_SIZE bytes) */
+      void encode(uint8_t* record) const;
+
+      /** Reads the fixed-layout binary record (ENCODED_SIZE bytes) */
+      void decode(const uint8_t* record);
+
+      /**
+       * Packs the action in 16 bits: y (bits 0-3), x (4-7), orientation (8), player (9-10) and
+       * action type (11-12). Only the position of a move, or the wall of a wall action, is kept.
+       */
+      uint16_t pack() const;
+
+      /** Unpacks an action packed by pack() */
+      void unpack(uint16_t packed);
+
       std::string serialize() const;
       void deserialize(const std::string& s);
    };
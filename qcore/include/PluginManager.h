@@ -10,6 +10,7 @@
 #include <string>
 #include <map>
 #include <list>
+#include <mutex>
 
 #define REGISTER_QUORIDOR_PLAYER(plugin) extern "C" void RegisterQuoridorPlayer() \
    { qcore::PluginManager::RegisterPlugin<plugin>(#plugin); }
@@ -36,6 +37,9 @@ namespace qcore
       /** List of registered plugins and custom Players constructors */
       static std::map<std::string, ConstructPlayerFun> RegisteredPlugins;
 
+      /** Protection against concurrent access to the registered plugins */
+      static std::mutex RegistryMutex;
+
       // Methods
    public:
 
@@ -44,6 +48,7 @@ namespace qcore
       {
          LOG_INFO("qcore::PM") << "Registering Plugin " << name;
 
+         std::lock_guard<std::mutex> lock(RegistryMutex);
          RegisteredPlugins[name] = [](PlayerId id, const std::string& name, GamePtr game)
             { return std::make_shared<T>(id, name, game); };
       }
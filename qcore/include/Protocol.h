@@ -0,0 +1,125 @@
+#ifndef Header_qcore_Protocol
+#define Header_qcore_Protocol
+
+#include "Qcore_API.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include <memory>
+
+namespace qcore
+{
+   /** Version of the wire protocol, exchanged during the handshake */
+   const uint8_t PROTOCOL_VERSION = 5;
+
+   /** Identifies a client request. Echoed by the server in the response, so requests can be pipelined. */
+   typedef uint32_t RequestId;
+
+   /** Identifies a game hosted by a game server. Clients join a game after the handshake. */
+   typedef uint32_t GameId;
+
+   /** Marks the absence of a game */
+   const GameId INVALID_GAME_ID = 0xFFFFFFFF;
+
+   /** Frame header: payload length (32-bit, little endian) followed by the message type */
+   const size_t FRAME_HEADER_SIZE = 5;
+
+   /** Larger frames are considered corrupted and close the connection */
+   const uint32_t MAX_FRAME_SIZE = 16 * 1024 * 1024;
+
+   /** Requests start with the request ID */
+   const size_t REQUEST_HEADER_SIZE = sizeof(RequestId);
+
+   /** Responses start with the request ID, followed by the status (0 on success) */
+   const size_t RESPONSE_HEADER_SIZE = sizeof(RequestId) + 1;
+
+   /** Writes a 32-bit integer in little endian order */
+   inline void writeUint32(uint8_t* data, uint32_t value)
+   {
+      data[0] = uint8_t(value);
+      data[1] = uint8_t(value >> 8);
+      data[2] = uint8_t(value >> 16);
+      data[3] = uint8_t(value >> 24);
+   }
+
+   /** Reads a 32-bit integer in little endian order */
+   inline uint32_t readUint32(const uint8_t* data)
+   {
+      return uint32_t(data[0]) | uint32_t(data[1]) << 8 | uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24;
+   }
+
+   /** Writes the header of a frame (FRAME_HEADER_SIZE bytes) */
+   QCODE_API void encodeFrameHeader(uint8_t* header, uint8_t messageType, uint32_t payloadSize);
+
+   /** An encoded frame (header and payload), shared by all the connections sending it */
+   typedef std::shared_ptr<const std::vector<uint8_t>> FrameBuffer;
+
+   /** Encodes a frame in a buffer which can be queued on several connections */
+   QCODE_API FrameBuffer encodeFrame(uint8_t messageType, const uint8_t* data, size_t size);
+
+   /** A received frame. Data is owned by the FrameReader. */
+   struct FrameView
+   {
+      uint8_t messageType;
+      const uint8_t* data;
+      size_t size;
+   };
+
+   /**
+    * Splits the received byte stream into frames. Bytes are received directly into a ring buffer,
+    * and frames are returned in place, so no memory is allocated per message. A frame that wraps
+    * around the end of the ring is copied to a scratch buffer which is reused. The ring grows only
+    * if a frame doesn't fit.
+    */
+   class QCODE_API FrameReader
+   {
+      // Encapsulated data members
+   private:
+
+      /** Ring buffer. The size is always a power of 2. */
+      std::vector<uint8_t> mBuffer;
+
+      /** Read and write positions, masked when indexing the ring */
+      size_t mHead;
+      size_t mTail;
+
+      /** Size of the last frame returned by next(), released on the next call */
+      size_t mFrameSize;
+
+      /** Linearized copy of the last frame, when it wraps around the ring */
+      std::vector<uint8_t> mScratch;
+
+      // Methods
+   public:
+
+      /** Construction */
+      explicit FrameReader(size_t capacity = 4096);
+
+      /** Returns the contiguous free space where the next bytes can be received */
+      std::pair<uint8_t*, size_t> prepare();
+
+      /** Marks bytes written in the space returned by prepare() as received */
+      void commit(size_t bytes);
+
+      /**
+       * Extracts the next complete frame. The frame stays valid until the next call of any method.
+       * @return false if no complete frame was received
+       */
+      bool next(FrameView& frame);
+
+   private:
+
+      /** Releases the last frame returned by next() */
+      void release();
+
+      /** Reallocates the ring, keeping the received bytes */
+      void grow(size_t capacity);
+
+      /** Returns the byte at the specified offset from the read position */
+      uint8_t peek(size_t offset) const { return mBuffer[(mHead + offset) & (mBuffer.size() - 1)]; }
+   };
+}
+
+#endif // Header_qcore_Protocol
@@ -5,6 +5,9 @@
 #include <string>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <mutex>
+#include <atomic>
 
 #include "Qcore_API.h"
 
@@ -25,8 +28,11 @@ namespace qcore
          std::string cause;
       };
 
-      /** Simple mechanism to facilitate logging throughout the application */
-      class Log
+      /**
+       * Simple mechanism to facilitate logging throughout the application. Lines are formatted by
+       * the logging thread and queued without locking, a background thread writes them in batches.
+       */
+      class QCODE_API Log
       {
       public:
          enum Level
@@ -52,27 +58,61 @@ namespace qcore
             return *this;
          }
 
+         /** Redirects the logs to the specified file. Ignored if already redirected. */
          static void init(const std::string &file);
 
+         /** Writes all the lines logged until now */
+         static void flush();
+
+         /** Sets the level of the domains without a level of their own */
+         static void setLevel(Level level);
+
+         /** Sets the level of all domains starting with the specified prefix. The longest prefix applies. */
+         static void setLevel(const std::string &domain, Level level);
+
+         /**
+          * Sets the levels from a comma separated list, such as "warn,qcore::GS=trace,qplugin=debug".
+          * Levels without a domain apply to all other domains. Replaces all previous levels.
+          */
+         static void configure(const std::string &levels);
+
+         /** Checks if the lines of the domain are written. Domains are only looked up if some have their own level. */
+         static bool isEnabled(Level level, const char *domain)
+         {
+            return level <= maxLevel.load(std::memory_order_relaxed)
+               and (not domainLevels.load(std::memory_order_relaxed) or isDomainEnabled(level, domain));
+         }
+
       private:
          bool domLogged = false;
          std::stringstream ss;
-         static std::ostream *logStream;
+
+         /** Highest level written by any domain */
+         static std::atomic<int> maxLevel;
+
+         /** Set if some domains have their own level */
+         static std::atomic<bool> domainLevels;
+
+         static bool isDomainEnabled(Level level, const char *domain);
       };
    }
 }
 
-// TODO: Replace this with an actual log library
-#define LOG_LEVEL qcore::util::Log::Info
+// Levels above QCORE_LOG_LEVEL are compiled out, with the expressions they log.
+// Set by the QUORIDOR_LOG_LEVEL build option; all levels are compiled by default.
+#ifndef QCORE_LOG_LEVEL
+#define QCORE_LOG_LEVEL 4
+#endif
 
-#define LOG(level) if (level <= LOG_LEVEL) qcore::util::Log()
+#define LOG_DOMAIN(level, DOM) if (level > QCORE_LOG_LEVEL or not qcore::util::Log::isEnabled(level, DOM)) {} else qcore::util::Log()
+#define LOG(level) LOG_DOMAIN(level, nullptr)
 
 #define LOG_INIT(file) qcore::util::Log::init(file)
-#define LOG_TRACE(DOM) LOG(qcore::util::Log::Trace) << DOM << " [trace] "
-#define LOG_DEBUG(DOM) LOG(qcore::util::Log::Debug) << DOM << " [debug] "
-#define LOG_INFO(DOM)  LOG(qcore::util::Log::Info)  << DOM << " [info]  "
-#define LOG_WARN(DOM)  LOG(qcore::util::Log::Warn)  << DOM << " [warn]  "
-#define LOG_ERROR(DOM) LOG(qcore::util::Log::Error) << DOM << " [error] "
+#define LOG_TRACE(DOM) LOG_DOMAIN(qcore::util::Log::Trace, DOM) << DOM << " [trace] "
+#define LOG_DEBUG(DOM) LOG_DOMAIN(qcore::util::Log::Debug, DOM) << DOM << " [debug] "
+#define LOG_INFO(DOM)  LOG_DOMAIN(qcore::util::Log::Info, DOM)  << DOM << " [info]  "
+#define LOG_WARN(DOM)  LOG_DOMAIN(qcore::util::Log::Warn, DOM)  << DOM << " [warn]  "
+#define LOG_ERROR(DOM) LOG_DOMAIN(qcore::util::Log::Error, DOM) << DOM << " [error] "
 
 
 #endif // Header_qcore_Util
@@ -5,9 +5,15 @@
 
 #include "Qcore_API.h"
 #include "Game.h"
+#include "Protocol.h"
+#include "GameController.h"
 
 #include <thread>
-#include <future>
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <chrono>
 
 #include <boost/bind.hpp>
 #include <boost/asio.hpp>
@@ -15,51 +21,107 @@
 
 namespace qcore
 {
-   // Forward declaration
-   class GameController;
-
+   /**
+    * Game played on a remote server. Requests are tagged with an ID, so any number of them can be in
+    * flight on the connection. Responses complete the matching request from the IO thread.
+    */
    class QCODE_API RemoteGame : public Game
    {
+      // Type definitions
+   public:
+
+      /** Completion of a request: the result, and either the response data or the failure reason */
+      typedef std::function<void(bool success, const std::string& data)> ResponseCb;
+
       // Encapsulated data members
    private:
 
       GameController& mGameController;
 
-      /** Boost IO Service */
+      /** Boost IO Service, run by a pool of threads */
       boost::asio::io_service mIoService;
       boost::asio::io_service::work mIoServiceWork;
-      std::thread mIoServiceThread;
+      std::vector<std::thread> mIoThreads;
+
+      /** Serializes the handling of the received messages */
+      boost::asio::io_service::strand mStrand;
 
       /** TCP client socket */
       boost::asio::ip::tcp::socket mSocket;
-      boost::array<char, 1024> mRecvData;
-      std::string mRecvBuffer;
-      std::promise<std::string> mPromiseResponse;
+      FrameReader mReader;
+
+      /** Requests waiting for the server response */
+      std::unordered_map<RequestId, ResponseCb> mPendingRequests;
+      RequestId mNextRequestId;
+      bool mConnected;
+      std::mutex mRequestMutex;
+
+      /** Serializes the writes of concurrent requests */
+      std::mutex mSendMutex;
+
+      /** Server's board version of the last applied update. Used only by the strand. */
+      uint32_t mRemoteVersion;
 
       // Methods
    public:
 
-      /** Construction */
-      RemoteGame(GameController& controller, uint8_t players, const std::string& ip);
+      /** Construction. Connects to the game server, the game must then be joined. */
+      RemoteGame(GameController& controller, uint8_t players, const std::string& ip, size_t ioThreads = 1);
 
-      virtual ~RemoteGame() = default;
+      /** Destruction. Pending requests fail. */
+      virtual ~RemoteGame();
+
+      /** Lists the games hosted by the server */
+      std::list<GameInfo> listGames();
+
+      /** Joins one of the games hosted by the server. The other requests are routed to this game. */
+      void joinGame(GameId gameId);
 
       /** Adds a player to the remote game server */
       PlayerId addRemotePlayer(const std::string& playerName);
 
+      /**
+       * Follows the game as a spectator: loads the current board, then receives its updates,
+       * grouped at the specified interval if not zero
+       */
+      void spectate(std::chrono::milliseconds batchInterval = std::chrono::milliseconds(0));
+
       /** Validates and sets the next user action */
       virtual bool processPlayerAction(const PlayerAction& action, std::string& reason) override;
 
+      /** Sends the next user action, without waiting for the server to process it */
+      void processPlayerActionAsync(const PlayerAction& action, ResponseCb callback);
+
+      /** Asks the server if the action is valid, without applying it */
+      bool validateAction(const PlayerAction& action, std::string& reason);
+      void validateActionAsync(const PlayerAction& action, ResponseCb callback);
+
+      /**
+       * Sends a request to the remote game server. The callback is called from the IO thread and must
+       * not wait for other requests.
+       */
+      void request(uint8_t messageType, const uint8_t* data, size_t size, ResponseCb callback);
+
+      /**
+       * Sends a request and waits for the response. Must not be called from a response callback.
+       * @return false if the server rejected the request, with the reason in result
+       */
+      bool call(uint8_t messageType, const uint8_t* data, size_t size, std::string& result);
+      bool call(uint8_t messageType, const std::string& payload, std::string& result);
+
    private:
 
-      /** Sends a message to the remote game server */
-      std::string send(const std::string& message);
+      /** Fails all pending requests, after the connection was lost */
+      void disconnect(const std::string& reason);
+
+      /** Receives the next bytes directly into the frame reader */
+      void startRead();
 
       /** Handles socket read */
       void handleRead(const boost::system::error_code& error, size_t bytesTransferred);
 
       /** Processes the message received from the remote game server */
-      void processMessage(const std::string& message);
+      void processMessage(const FrameView& frame);
    };
 
    typedef std::shared_ptr<RemoteGame> RemoteGamePtr;
@@ -0,0 +1,147 @@
+#ifndef Header_qcore_SearchState
+#define Header_qcore_SearchState
+
+#include "Qcore_API.h"
+#include "PlayerAction.h"
+#include "BitBoard.h"
+#include "Zobrist.h"
+
+#include <cstddef>
+
+namespace qcore
+{
+   // Forward declaration
+   class BoardSnapshot;
+
+   /** Maximum number of pawn moves of a player: a step, a jump or two side steps in each direction */
+   const size_t MAX_PAWN_MOVES = 12;
+
+   /** Maximum number of wall placements */
+   const size_t MAX_WALL_PLACEMENTS = 2 * WALL_SLOTS * WALL_SLOTS;
+
+   /** Maximum number of actions of a player */
+   const size_t MAX_ACTIONS = MAX_PAWN_MOVES + MAX_WALL_PLACEMENTS;
+
+   /** What SearchState::undoAction() needs to restore the state before an action */
+   struct ActionUndo
+   {
+      /** The player who made the action */
+      PlayerId playerId;
+
+      /** Square the pawn moved from, NO_SQUARE for walls */
+      uint8_t square;
+
+      /** Slot of the wall placed */
+      uint8_t wallSlot;
+
+      /** Orientation of the wall placed */
+      Orientation orientation;
+   };
+
+   /**
+    * Game state for search engines. Trivially copyable, with no allocation and no locking, so a
+    * search can copy it for every node. Follows the rules of Game::isActionValid.
+    *
+    * All positions and actions are in absolute coordinates (player 0's perspective). Actions are
+    * converted with toRelative() before being sent to the game.
+    */
+   class QCODE_API SearchState
+   {
+      // Encapsulated data members
+   private:
+
+      BitBoard mBoard;
+
+      /** Walls left for each player */
+      uint8_t mWallsLeft[MAX_PLAYERS];
+
+      uint8_t mNumberOfPlayers;
+
+      /** The player on move */
+      PlayerId mCurrentPlayer;
+
+      /** The player who won, 0xFF while the game is running */
+      PlayerId mWinner;
+
+      /** Zobrist hash of the position, updated by every action */
+      uint64_t mHash;
+
+      // Methods
+   public:
+
+      /** Construction of the initial state of a game */
+      explicit SearchState(uint8_t players = 2, uint8_t walls = 0);
+
+      /** Construction from a board of a game, with the specified player on move */
+      SearchState(const BoardSnapshot& snapshot, PlayerId currentPlayer);
+
+      uint8_t getNumberOfPlayers() const { return mNumberOfPlayers; }
+
+      /** Returns the player on move */
+      PlayerId getCurrentPlayer() const { return mCurrentPlayer; }
+
+      /** Flags if a player reached his goal */
+      bool isFinished() const { return mWinner != 0xFF; }
+
+      /** Returns the player who won, 0xFF while the game is running */
+      PlayerId getWinner() const { return mWinner; }
+
+      /** Returns the position of a pawn */
+      Position getPawn(PlayerId id) const { return mBoard.getPawn(id); }
+
+      /** Returns the number of walls left for the specified player */
+      uint8_t getWallsLeft(PlayerId id) const { return mWallsLeft[id]; }
+
+      /** Returns the compact board representation */
+      const BitBoard& getBitBoard() const { return mBoard; }
+
+      /** Returns the Zobrist hash of the position, equal to the one of the game's snapshot */
+      uint64_t getHash() const { return mHash; }
+
+      /** Returns the number of steps the player needs to reach his goal, ignoring other pawns. 0xFF if blocked. */
+      uint8_t getGoalDistance(PlayerId id) const;
+
+      /** Checks if the player can still reach his goal */
+      bool hasPathToGoal(PlayerId id) const { return mBoard.hasPathToGoal(id); }
+
+      /** Writes the pawn moves of the player on move, at most MAX_PAWN_MOVES. Returns their number. */
+      size_t generateMoves(PlayerAction* moves) const;
+
+      /** Writes the wall placements of the player on move, at most MAX_WALL_PLACEMENTS. Returns their number. */
+      size_t generateWalls(PlayerAction* walls) const;
+
+      /** Writes all actions of the player on move, at most MAX_ACTIONS. Returns their number. */
+      size_t generateActions(PlayerAction* actions) const;
+
+      /** Checks if the action is legal for the player on move */
+      bool isLegal(const PlayerAction& action) const;
+
+      /** Applies a legal action and passes the move to the next player. Use doAction() to undo it later. */
+      void applyAction(const PlayerAction& action) { doAction(action); }
+
+      /** Applies a legal action in place and returns what is needed to undo it */
+      ActionUndo doAction(const PlayerAction& action);
+
+      /** Restores the state before the action. Actions are undone in the reverse order. */
+      void undoAction(const ActionUndo& undo);
+
+      /** Converts an action to the perspective of the player making it, as expected by the game */
+      PlayerAction toRelative(const PlayerAction& action) const;
+
+   private:
+
+      /** Checks if the wall can be placed without intersecting another one or blocking a player */
+      bool isWallLegal(const WallState& wall) const;
+
+      /** Checks if the wall, intersecting no other one, leaves a path to goal for every player */
+      bool isWallLeavingPaths(const WallState& wall) const;
+
+      /**
+       * Marks the wall slots cutting a shortest path to goal of any player, indexed by Orientation.
+       * Walls on the other slots leave all the paths open.
+       */
+      void getPathCuts(uint64_t cuts[2]) const;
+   };
+}
+
+#endif // Header_qcore_SearchState
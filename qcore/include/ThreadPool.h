@@ -0,0 +1,94 @@
+#ifndef Header_qcore_ThreadPool
+#define Header_qcore_ThreadPool
+
+#include "Qcore_API.h"
+#include "Executor.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <deque>
+
+namespace qcore
+{
+   /**
+    * Fixed set of worker threads. Tasks posted with an affinity are queued to a specific worker and
+    * are stolen by other workers only when they have nothing else to do.
+    */
+   class QCODE_API ThreadPool : public Executor
+   {
+      // Type definitions
+   private:
+
+      struct Worker
+      {
+         std::thread thread;
+         std::deque<Task> tasks;
+         std::condition_variable cv;
+         bool idle = false;
+      };
+
+      // Encapsulated data members
+   private:
+
+      /** Worker threads and their own task queues */
+      std::vector<std::unique_ptr<Worker>> mWorkers;
+
+      /** Tasks without affinity, waiting for a free worker */
+      std::deque<Task> mTasks;
+
+      /** Number of tasks posted and not finished yet */
+      size_t mPendingTasks;
+
+      /** Set on destruction, to stop the workers */
+      bool mStopped;
+
+      /** Protection against concurrent access */
+      std::mutex mMutex;
+      std::condition_variable mIdleCv;
+
+      // Methods
+   public:
+
+      /** Construction. By default, one worker is started for each hardware thread. */
+      explicit ThreadPool(size_t threads = 0);
+
+      /** Destruction. Waits for the running tasks, the queued ones are dropped. */
+      ~ThreadPool();
+
+      ThreadPool(const ThreadPool&) = delete;
+      ThreadPool& operator=(const ThreadPool&) = delete;
+
+      /**
+       * Returns the pool shared by all games of the process. Its size is read from
+       * QUORIDOR_WORKER_THREADS, defaulting to the number of hardware threads.
+       */
+      static std::shared_ptr<ThreadPool> Shared();
+
+      /** Returns the number of worker threads */
+      size_t size() const { return mWorkers.size(); }
+
+      /** Queues a task to be executed by one of the workers */
+      void post(Task task, size_t affinity = NO_AFFINITY) override;
+
+      /** Returns the maximum number of tasks running in parallel */
+      size_t getConcurrency() const override { return mWorkers.size(); }
+
+      /** Blocks until all posted tasks have finished */
+      void wait();
+
+   private:
+
+      /** Worker thread loop */
+      void run(size_t index);
+
+      /** Picks the next task for a worker: its own first, then shared ones, then other workers' */
+      bool nextTask(size_t index, Task& task);
+
+      /** Wakes up an idle worker, preferably the specified one */
+      void wakeUp(size_t preferred);
+   };
+}
+
+#endif // Header_qcore_ThreadPool
@@ -0,0 +1,66 @@
+#ifndef Header_qcore_TimeControl
+#define Header_qcore_TimeControl
+
+#include "Qcore_API.h"
+
+#include <chrono>
+
+namespace qcore
+{
+   /** Thinking time allowed to a player. A zero duration means no limit. */
+   struct QCODE_API TimeControl
+   {
+      /** Thinking time for the whole game */
+      std::chrono::milliseconds budget = std::chrono::milliseconds(0);
+
+      /** Time added to the budget after each move (Fischer increment) */
+      std::chrono::milliseconds increment = std::chrono::milliseconds(0);
+
+      /** Time limit for a single move */
+      std::chrono::milliseconds moveLimit = std::chrono::milliseconds(0);
+   };
+
+   /** Keeps track of the thinking time left for a player */
+   class QCODE_API PlayerClock
+   {
+      // Type definitions
+   public:
+
+      typedef std::chrono::steady_clock Clock;
+
+      // Encapsulated data members
+   private:
+
+      /** Time allowed to the player */
+      TimeControl mTimeControl;
+
+      /** Time left from the budget */
+      std::chrono::milliseconds mRemaining;
+
+      // Methods
+   public:
+
+      /** Construction */
+      explicit PlayerClock(const TimeControl& timeControl = TimeControl());
+
+      /** Returns the time allowed to the player */
+      const TimeControl& getTimeControl() const { return mTimeControl; }
+
+      /** Returns the time left from the budget */
+      std::chrono::milliseconds getRemaining() const { return mRemaining; }
+
+      /** Checks if there is any time limit */
+      bool isLimited() const { return mTimeControl.budget.count() or mTimeControl.moveLimit.count(); }
+
+      /** Returns the moment the player runs out of time, for a move started now. Clock::time_point::max() if not limited. */
+      Clock::time_point getDeadline(Clock::time_point moveStart) const;
+
+      /**
+       * Charges the duration of a move and adds the increment
+       * @return false if the player exceeded his time
+       */
+      bool stop(std::chrono::milliseconds elapsed);
+   };
+}
+
+#endif // Header_qcore_TimeControl
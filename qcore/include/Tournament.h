@@ -0,0 +1,145 @@
+#ifndef Header_qcore_Tournament
+#define Header_qcore_Tournament
+
+#include "Qcore_API.h"
+#include "PlayerAction.h"
+#include "TimeControl.h"
+#include "GameRecord.h"
+
+#include <functional>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <list>
+#include <mutex>
+
+namespace qcore
+{
+   /** Rules of a tournament */
+   struct TournamentSettings
+   {
+      /** Number of games played by each pair of plugins. Sides are swapped after each game. */
+      uint32_t gamesPerPair = 2;
+
+      /** Time allowed to each player */
+      TimeControl timeControl = { std::chrono::milliseconds(0), std::chrono::milliseconds(0), std::chrono::milliseconds(5000) };
+
+      /** Number of moves after which the game is declared a draw */
+      uint32_t maxMoves = 400;
+
+      /** Number of games played in parallel. 0 to use all hardware threads. */
+      uint32_t threads = 0;
+
+      /** Records the played games, if set */
+      GameRecordWriterPtr recordWriter;
+   };
+
+   /** Outcome of a tournament game */
+   struct GameResult
+   {
+      /** Plugins of player 0 (first to move) and player 1 */
+      std::string plugins[2];
+
+      /** The player who won, 0xFF for a draw */
+      PlayerId winner = 0xFF;
+
+      /** Flags if the loser exceeded his time limit or returned without moving */
+      bool timeout = false;
+
+      /** Number of moves made in the game */
+      uint32_t moves = 0;
+
+      /** Duration of the game, in milliseconds */
+      uint32_t durationMs = 0;
+
+      /** Flags if the game was played */
+      bool finished = false;
+   };
+
+   /** Standing of a plugin in the tournament */
+   struct TournamentStanding
+   {
+      std::string plugin;
+      uint32_t games = 0;
+      uint32_t wins = 0;
+      uint32_t draws = 0;
+      uint32_t losses = 0;
+      uint32_t timeouts = 0;
+
+      /** One point for a win, half a point for a draw */
+      double score = 0;
+
+      /** Elo rating, starting from INITIAL_ELO */
+      double elo = 0;
+   };
+
+   /**
+    * Round-robin tournament between plugins. Every game runs on its own Game instance, with its own
+    * players, so games are independent and are played in parallel on a pool of worker threads.
+    *
+    * The game loop is driven by the worker thread, without the GameController's watchdog: a player
+    * that runs out of time without making a valid move loses the game once doNextMove() returns.
+    */
+   class QCODE_API Tournament
+   {
+      // Type definitions
+   public:
+
+      /** Elo rating of a new plugin */
+      static constexpr double INITIAL_ELO = 1500;
+
+      /** Elo K-factor */
+      static constexpr double ELO_K = 16;
+
+      typedef std::function<void(size_t index, const GameResult& result)> GameFinishedCb;
+
+      // Encapsulated data members
+   private:
+
+      /** Rules of the tournament */
+      TournamentSettings mSettings;
+
+      /** Participating plugins */
+      std::vector<std::string> mPlugins;
+
+      /** All games of the tournament, in pairing order */
+      std::vector<GameResult> mGames;
+
+      /** Number of games played so far */
+      size_t mFinishedGames;
+
+      /** Protection against concurrent access */
+      mutable std::mutex mMutex;
+
+      // Methods
+   public:
+
+      /** Construction. Pairs every plugin with all the others. */
+      Tournament(const std::list<std::string>& plugins, const TournamentSettings& settings);
+
+      /** Returns the number of games of the tournament */
+      size_t getNumberOfGames() const { return mGames.size(); }
+
+      /** Returns the number of games played so far */
+      size_t getFinishedGames() const;
+
+      /**
+       * Plays all games and blocks until the tournament ends. The callback is invoked from the worker
+       * threads after each game, one at a time.
+       */
+      void run(GameFinishedCb gameFinishedCb = nullptr);
+
+      /** Returns the results of all games, in pairing order */
+      std::vector<GameResult> getResults() const;
+
+      /** Returns the standings, sorted by score. Elo ratings are computed in pairing order. */
+      std::vector<TournamentStanding> getStandings() const;
+
+   private:
+
+      /** Plays a single game in the calling thread */
+      void playGame(GameResult& result) const;
+   };
+}
+
+#endif // Header_qcore_Tournament
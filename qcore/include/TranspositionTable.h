@@ -0,0 +1,118 @@
+#ifndef Header_qcore_TranspositionTable
+#define Header_qcore_TranspositionTable
+
+#include "Qcore_API.h"
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+namespace qcore
+{
+   /** Kind of score stored for a position, as produced by an alpha-beta search */
+   enum class Bound : uint8_t
+   {
+      None,
+      Exact,
+      Lower,
+      Upper
+   };
+
+   /** Search result of a position, as stored in a TranspositionTable */
+   struct TranspositionEntry
+   {
+      int32_t score;
+
+      /** Remaining depth of the search that produced the score */
+      uint8_t depth;
+
+      Bound bound;
+
+      /** Best action found, packed by PlayerAction::pack() */
+      uint16_t action;
+   };
+
+   /**
+    * Fixed-size hash table of search results, indexed by the Zobrist hash of the positions. Entries
+    * are grouped in buckets of one cache line, so a probe reads a single line.
+    *
+    * The table can be shared by the threads of a search without locking: each entry stores its data
+    * with the hash XOR-ed by the data, so an entry torn by concurrent writes fails verification and
+    * reads as a miss. Entries of older searches (see newSearch()) are replaced first.
+    */
+   class QCODE_API TranspositionTable
+   {
+      // Type definitions
+   private:
+
+      struct Slot
+      {
+         /** Hash XOR-ed by the data */
+         std::atomic<uint64_t> key;
+
+         /** Score (bits 0-31), depth (32-39), bound (40-41), generation (42-47) and action (48-63) */
+         std::atomic<uint64_t> data;
+      };
+
+      /** Number of entries per bucket */
+      static const size_t BUCKET_SLOTS = 4;
+
+      struct alignas(64) Bucket
+      {
+         Slot slots[BUCKET_SLOTS];
+      };
+
+      // Encapsulated data members
+   private:
+
+      /** Allocated memory, larger than the buckets to align them on a cache line */
+      std::unique_ptr<uint8_t[]> mMemory;
+
+      Bucket* mBuckets;
+
+      /** Number of buckets minus one. The number of buckets is a power of two. */
+      size_t mMask;
+
+      /** Generation of the current search, on 6 bits */
+      uint8_t mGeneration;
+
+      // Methods
+   public:
+
+      /** Construction of a table using at most the specified memory */
+      explicit TranspositionTable(size_t megabytes = 16);
+
+      /** Reallocates the table, discarding all entries. Not safe during a search. */
+      void resize(size_t megabytes);
+
+      /** Discards all entries. Not safe during a search. */
+      void clear();
+
+      /** Starts a new search: entries stored before are replaced first */
+      void newSearch() { mGeneration = (mGeneration + 1) & 0x3F; }
+
+      /** Returns the number of entries */
+      size_t getCapacity() const { return (mMask + 1) * BUCKET_SLOTS; }
+
+      /** Looks for a position. Returns false if the position was not stored or has been replaced. */
+      bool probe(uint64_t hash, TranspositionEntry& entry) const;
+
+      /**
+       * Stores the result of a position. A result of the same position is kept only if it was
+       * searched deeper in the current search; otherwise the least valuable entry of the bucket is
+       * replaced.
+       */
+      void store(uint64_t hash, const TranspositionEntry& entry);
+
+      /** Returns the permille of entries written by the current search, estimated on the first buckets */
+      unsigned getUsage() const;
+
+   private:
+
+      /** Returns the bucket of a position */
+      Bucket& getBucket(uint64_t hash) const { return mBuckets[hash & mMask]; }
+   };
+}
+
+#endif // Header_qcore_TranspositionTable
@@ -0,0 +1,114 @@
+#ifndef Header_qcore_Zobrist
+#define Header_qcore_Zobrist
+
+#include "BitBoard.h"
+
+namespace qcore
+{
+   /** Number of walls left counts with distinct keys. Higher counts reuse the keys modulo this number. */
+   const uint8_t ZOBRIST_WALLS_LEFT = 32;
+
+   /** Mixes a counter into a well distributed 64 bit value (splitmix64) */
+   constexpr uint64_t splitMix64(uint64_t x)
+   {
+      x += 0x9E3779B97F4A7C15ull;
+      x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+      x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+      return x ^ (x >> 31);
+   }
+
+   /**
+    * Random keys of Zobrist hashing, generated at compile time. The hash of a position is the XOR of
+    * the keys of the pawn squares, the occupied wall slots, the walls left of each player and the
+    * player on move, so each action updates it with a few XORs. All squares and slots are in
+    * absolute coordinates, as in the BitBoard.
+    */
+   struct ZobristKeys
+   {
+      uint64_t pawnKeys[MAX_PLAYERS][BOARD_SQUARES];
+      uint64_t wallKeys[2][WALL_SLOTS * WALL_SLOTS];
+      uint64_t wallsLeftKeys[MAX_PLAYERS][ZOBRIST_WALLS_LEFT];
+      uint64_t sideKeys[MAX_PLAYERS];
+
+      constexpr ZobristKeys() :
+         pawnKeys{},
+         wallKeys{},
+         wallsLeftKeys{},
+         sideKeys{}
+      {
+         uint64_t counter = 0;
+
+         for (auto& player : pawnKeys)
+         {
+            for (auto& key : player)
+            {
+               key = splitMix64(counter++);
+            }
+         }
+
+         for (auto& orientation : wallKeys)
+         {
+            for (auto& key : orientation)
+            {
+               key = splitMix64(counter++);
+            }
+         }
+
+         for (auto& player : wallsLeftKeys)
+         {
+            for (auto& key : player)
+            {
+               key = splitMix64(counter++);
+            }
+         }
+
+         for (auto& key : sideKeys)
+         {
+            key = splitMix64(counter++);
+         }
+      }
+
+      /** Key of a pawn on a square */
+      constexpr uint64_t pawn(PlayerId id, uint8_t square) const { return pawnKeys[id][square]; }
+
+      /** Key of an occupied wall slot */
+      constexpr uint64_t wall(Orientation o, uint8_t slot) const { return wallKeys[static_cast<int>(o)][slot]; }
+
+      /** Key of the number of walls left of a player */
+      constexpr uint64_t wallsLeft(PlayerId id, uint8_t count) const { return wallsLeftKeys[id][count % ZOBRIST_WALLS_LEFT]; }
+
+      /** Key of the player on move */
+      constexpr uint64_t side(PlayerId id) const { return sideKeys[id]; }
+
+      /** Computes the hash of a whole position */
+      uint64_t hash(const BitBoard& board, const uint8_t* wallCounts, uint8_t players, PlayerId current) const
+      {
+         uint64_t h = side(current);
+
+         for (PlayerId id = 0; id < players; ++id)
+         {
+            h ^= pawn(id, BitBoard::square(board.getPawn(id))) ^ wallsLeft(id, wallCounts[id]);
+         }
+
+         for (Orientation o : { Orientation::Vertical, Orientation::Horizontal })
+         {
+            uint64_t bits = board.getWalls(o);
+
+            for (uint8_t slot = 0; bits; ++slot, bits >>= 1)
+            {
+               if (bits & 1)
+               {
+                  h ^= wall(o, slot);
+               }
+            }
+         }
+
+         return h;
+      }
+   };
+
+   /** Keys shared by all hashes, so hashes of different components can be compared */
+   constexpr ZobristKeys ZOBRIST{};
+}
+
+#endif // Header_qcore_Zobrist
@@ -0,0 +1,193 @@
+#include "BitBoard.h"
+
+namespace qcore
+{
+   static_assert(WALL_SLOTS * WALL_SLOTS == 64, "Wall slots must fit in a 64 bit set");
+
+   /** Wall slots of the first and of the last column */
+   static const uint64_t FIRST_WALL_COLUMN = 0x0101010101010101ull;
+   static const uint64_t LAST_WALL_COLUMN = FIRST_WALL_COLUMN << (WALL_SLOTS - 1);
+
+   /** Construction of an empty board */
+   BitBoard::BitBoard() :
+      mWalls{},
+      mPawns{ NO_SQUARE, NO_SQUARE, NO_SQUARE, NO_SQUARE },
+      mInitialStates{ Direction::Down, Direction::Down, Direction::Down, Direction::Down }
+   {
+   }
+
+   /** Checks if the wall is inside board's boundaries */
+   bool BitBoard::isWallOnBoard(const WallState& w)
+   {
+      if (w.orientation == Orientation::Vertical)
+      {
+         return w.position.x >= 0 and w.position.x < WALL_SLOTS and w.position.y >= 1 and w.position.y <= WALL_SLOTS;
+      }
+
+      return w.position.x >= 1 and w.position.x <= WALL_SLOTS and w.position.y >= 0 and w.position.y < WALL_SLOTS;
+   }
+
+   /** Returns the slot of a wall that is inside board's boundaries */
+   uint8_t BitBoard::wallSlot(const WallState& w)
+   {
+      // The middle point of a vertical wall is at the bottom left corner of its position,
+      // while the middle point of a horizontal wall is at the top right corner.
+      if (w.orientation == Orientation::Vertical)
+      {
+         return uint8_t(w.position.x * WALL_SLOTS + w.position.y - 1);
+      }
+
+      return uint8_t((w.position.x - 1) * WALL_SLOTS + w.position.y);
+   }
+
+   /** Checks if the position is on the side of the board that must be reached by the player */
+   bool BitBoard::isGoal(const Position& p, Direction initialState)
+   {
+      switch (initialState)
+      {
+         case Direction::Down:
+            return p.x == 0;
+         case Direction::Up:
+            return p.x == BOARD_SIZE - 1;
+         case Direction::Right:
+            return p.y == 0;
+         case Direction::Left:
+            return p.y == BOARD_SIZE - 1;
+         default:
+            return false;
+      }
+   }
+
+   /** Adds a player on the board */
+   void BitBoard::setPlayer(PlayerId id, const Position& p, Direction initialState)
+   {
+      mPawns[id] = square(p);
+      mInitialStates[id] = initialState;
+   }
+
+   /** Checks if the specified position is occupied by a pawn */
+   bool BitBoard::isPawn(const Position& p) const
+   {
+      if (not isOnBoard(p))
+      {
+         return false;
+      }
+
+      uint8_t sq = square(p);
+      return mPawns[0] == sq or mPawns[1] == sq or mPawns[2] == sq or mPawns[3] == sq;
+   }
+
+   /** Checks if the wall overlaps or crosses a wall already placed */
+   bool BitBoard::isWallIntersecting(const WallState& w) const
+   {
+      uint8_t slot = wallSlot(w);
+
+      return (mWalls[0] & WALL_CONFLICTS.get(w.orientation, slot, Orientation::Vertical)) or
+         (mWalls[1] & WALL_CONFLICTS.get(w.orientation, slot, Orientation::Horizontal));
+   }
+
+   /** Returns the bitset of the slots where a wall of the specified orientation intersects no wall already placed */
+   uint64_t BitBoard::getFreeWallSlots(Orientation o) const
+   {
+      uint64_t vertical = mWalls[static_cast<int>(Orientation::Vertical)];
+      uint64_t horizontal = mWalls[static_cast<int>(Orientation::Horizontal)];
+
+      // Same masks as WALL_CONFLICTS, for all the walls at once: the slot itself in both
+      // orientations, and the slots above and below or on the sides. Shifts by one column must not
+      // wrap to the next row.
+      if (o == Orientation::Vertical)
+      {
+         return ~(vertical | vertical << WALL_SLOTS | vertical >> WALL_SLOTS | horizontal);
+      }
+
+      return ~(horizontal | ((horizontal << 1) & ~FIRST_WALL_COLUMN) | ((horizontal >> 1) & ~LAST_WALL_COLUMN) | vertical);
+   }
+
+   /** Places a wall. Walls outside board's boundaries are ignored. */
+   void BitBoard::placeWall(const WallState& w)
+   {
+      if (not isWallOnBoard(w))
+      {
+         return;
+      }
+
+      mWalls[static_cast<int>(w.orientation)] |= uint64_t(1) << wallSlot(w);
+   }
+
+   /** Checks if a step from the specified position in the specified direction is blocked by a wall or the board's edge */
+   bool BitBoard::isBlocked(const Position& p, Direction d) const
+   {
+      if (not isOnBoard(p + d))
+      {
+         return true;
+      }
+
+      switch (d)
+      {
+         case Direction::Up:
+            return hasWall(Orientation::Horizontal, p.x - 1, p.y) or hasWall(Orientation::Horizontal, p.x - 1, p.y - 1);
+         case Direction::Down:
+            return hasWall(Orientation::Horizontal, p.x, p.y) or hasWall(Orientation::Horizontal, p.x, p.y - 1);
+         case Direction::Left:
+            return hasWall(Orientation::Vertical, p.x, p.y - 1) or hasWall(Orientation::Vertical, p.x - 1, p.y - 1);
+         case Direction::Right:
+            return hasWall(Orientation::Vertical, p.x, p.y) or hasWall(Orientation::Vertical, p.x - 1, p.y);
+         default:
+            return true;
+      }
+   }
+
+   /** Checks if the player can still reach its goal. Pawns don't block the path. */
+   bool BitBoard::hasPathToGoal(PlayerId id) const
+   {
+      if (mPawns[id] == NO_SQUARE)
+      {
+         return true;
+      }
+
+      uint8_t queue[BOARD_SQUARES];
+      bool visited[BOARD_SQUARES] = {};
+      uint8_t head = 0;
+      uint8_t tail = 0;
+
+      queue[tail++] = mPawns[id];
+      visited[mPawns[id]] = true;
+
+      while (head != tail)
+      {
+         Position p = position(queue[head++]);
+
+         if (isGoal(p, mInitialStates[id]))
+         {
+            return true;
+         }
+
+         for (Direction d : { Direction::Up, Direction::Down, Direction::Left, Direction::Right })
+         {
+            if (not isBlocked(p, d))
+            {
+               uint8_t next = square(p + d);
+
+               if (not visited[next])
+               {
+                  visited[next] = true;
+                  queue[tail++] = next;
+               }
+            }
+         }
+      }
+
+      return false;
+   }
+
+   /** Checks a wall slot, ignoring slots outside board's boundaries */
+   bool BitBoard::hasWall(Orientation o, int row, int column) const
+   {
+      if (row < 0 or column < 0 or row >= WALL_SLOTS or column >= WALL_SLOTS)
+      {
+         return false;
+      }
+
+      return (mWalls[static_cast<int>(o)] >> (row * WALL_SLOTS + column)) & 1;
+   }
+} // namespace qcore
@@ -0,0 +1,101 @@
+#include "BoardHistory.h"
+#include "QcoreUtil.h"
+
+namespace qcore
+{
+   /** Destruction. Releases the unshared previous entries iteratively, long histories would overflow the stack. */
+   BoardHistory::Node::~Node()
+   {
+      std::shared_ptr<Node> node = std::move(previous);
+
+      while (node and node.use_count() == 1)
+      {
+         node = std::move(node->previous);
+      }
+   }
+
+   /** Construction of an empty history */
+   BoardHistory::BoardHistory(uint8_t players) :
+      mNumberOfPlayers(players)
+   {
+   }
+
+   /**
+    * Returns a new history with the action added, in absolute coordinates. The board after the
+    * action is kept if it is a checkpoint, and rebuilt otherwise if null.
+    */
+   BoardHistory BoardHistory::push(const PlayerAction& action, BoardSnapshotPtr board) const
+   {
+      BoardHistory history(mNumberOfPlayers);
+      history.mHead = std::make_shared<Node>();
+      history.mHead->previous = mHead;
+      history.mHead->action = action;
+      history.mHead->length = size() + 1;
+
+      if (history.mHead->length % HISTORY_CHECKPOINT_INTERVAL == 0)
+      {
+         history.mHead->board = board ? board : history.getSnapshot();
+      }
+
+      return history;
+   }
+
+   /** Returns the history of the first actions. Throws if longer than this history. */
+   BoardHistory BoardHistory::getPrefix(size_t length) const
+   {
+      if (length > size())
+      {
+         throw util::Exception("History has only " + std::to_string(size()) + " actions");
+      }
+
+      BoardHistory history(*this);
+
+      while (history.size() > length)
+      {
+         history.mHead = history.mHead->previous;
+      }
+
+      return history;
+   }
+
+   /** Returns all the actions, in absolute coordinates */
+   std::vector<PlayerAction> BoardHistory::getActions() const
+   {
+      std::vector<PlayerAction> actions(size());
+
+      for (Node* node = mHead.get(); node; node = node->previous.get())
+      {
+         actions[node->length - 1] = node->action;
+      }
+
+      return actions;
+   }
+
+   /** Returns the board after the last action, rebuilt from the closest checkpoint */
+   BoardSnapshotPtr BoardHistory::getSnapshot() const
+   {
+      std::vector<const PlayerAction*> actions;
+      Node* node = mHead.get();
+
+      while (node and not node->board)
+      {
+         actions.push_back(&node->action);
+         node = node->previous.get();
+      }
+
+      if (node and actions.empty())
+      {
+         return node->board;
+      }
+
+      auto board = node ? std::make_shared<BoardSnapshot>(*node->board) : std::make_shared<BoardSnapshot>(mNumberOfPlayers);
+
+      for (auto it = actions.rbegin(); it != actions.rend(); ++it)
+      {
+         board->replayAction(**it);
+      }
+
+      return board;
+   }
+
+} // namespace qcore
@@ -0,0 +1,338 @@
+#include "BoardSnapshot.h"
+#include "Protocol.h"
+#include "QcoreUtil.h"
+#include "Zobrist.h"
+
+namespace qcore
+{
+   /** Log domain */
+   const char * const DOM = "qcore::BS";
+
+   /** Construction of the initial board */
+   BoardSnapshot::BoardSnapshot(uint8_t players, uint8_t walls) :
+      mVersion(0),
+      mFinished(false),
+      mWinner(0xFF)
+   {
+      mPlayers.resize(players);
+
+      // Set initial player position
+      if (players == 2)
+      {
+         if (walls == 0)
+         {
+            walls = 10;
+         }
+
+         mPlayers[0].position = { BOARD_SIZE - 1, BOARD_SIZE / 2 };
+         mPlayers[0].initialState = Direction::Down;
+         mPlayers[0].wallsLeft = walls;
+
+         mPlayers[1].position = { 0, BOARD_SIZE / 2 };
+         mPlayers[1].initialState = Direction::Up;
+         mPlayers[1].wallsLeft = walls;
+      }
+      else if (players == 4)
+      {
+         if (walls == 0)
+         {
+            walls = 5;
+         }
+
+         mPlayers[0].position = { BOARD_SIZE - 1, BOARD_SIZE / 2 };
+         mPlayers[0].initialState = Direction::Down;
+         mPlayers[0].wallsLeft = walls;
+
+         mPlayers[1].position = { BOARD_SIZE / 2, BOARD_SIZE - 1 };
+         mPlayers[1].initialState = Direction::Right;
+         mPlayers[1].wallsLeft = walls;
+
+         mPlayers[2].position = { 0, BOARD_SIZE / 2 };
+         mPlayers[2].initialState = Direction::Up;
+         mPlayers[2].wallsLeft = walls;
+
+         mPlayers[3].position = { BOARD_SIZE / 2, 0 };
+         mPlayers[3].initialState = Direction::Left;
+         mPlayers[3].wallsLeft = walls;
+      }
+      else
+      {
+         throw util::Exception( "Invalid number of players" );
+      }
+
+      for (size_t i = 0; i < mPlayers.size(); ++i)
+      {
+         mBitBoard.setPlayer(i, mPlayers[i].position, mPlayers[i].initialState);
+      }
+
+      mDistances.resize(players);
+
+      for (size_t i = 0; i < mPlayers.size(); ++i)
+      {
+         mDistances[i].reset(mBitBoard, mPlayers[i].initialState);
+      }
+
+      mWallViews.resize(players);
+      updatePlayerViews();
+      updateHash(0);
+   }
+
+   /** Check if the specified space is occupied by a pawn */
+   bool BoardSnapshot::isSpaceEmpty(const Position& position, const PlayerId id) const
+   {
+      for (auto &player : mPlayerViews.at(id))
+      {
+         if (player.position == position)
+         {
+            return false;
+         }
+      }
+
+      return true;
+   }
+
+   /** Returns the number of steps the player needs to reach its goal, ignoring other pawns */
+   uint8_t BoardSnapshot::getGoalDistance(const PlayerId player) const
+   {
+      return mDistances.at(player).get(mPlayers.at(player).position);
+   }
+
+   /** Returns the number of steps from the specified position to player's goal, ignoring other pawns */
+   uint8_t BoardSnapshot::getGoalDistance(const PlayerId player, const Position& position, const PlayerId id) const
+   {
+      uint8_t rotations = 4 - static_cast<int>(mPlayers.at(id).initialState);
+
+      return mDistances.at(player).get(position.rotate(rotations));
+   }
+
+   /** Appends the compact binary form of the board: players and walls only, in absolute coordinates */
+   void BoardSnapshot::encode(std::vector<uint8_t>& data) const
+   {
+      const std::vector<WallState>& walls = mWallViews.at(0);
+      uint8_t rotations = 4 - static_cast<int>(mPlayers.at(0).initialState);
+      size_t offset = data.size();
+
+      data.resize(offset + 7 + PlayerAction::ENCODED_SIZE + mPlayers.size() * 4 + 1 + walls.size() * 3);
+      uint8_t* record = &data[offset];
+
+      writeUint32(record, mVersion);
+      record[4] = (uint8_t) mPlayers.size();
+      record[5] = mFinished;
+      record[6] = mWinner;
+      mLastAction.encode(record + 7);
+      record += 7 + PlayerAction::ENCODED_SIZE;
+
+      for (auto& p : mPlayers)
+      {
+         *record++ = (uint8_t) p.initialState;
+         *record++ = (uint8_t) p.position.x;
+         *record++ = (uint8_t) p.position.y;
+         *record++ = p.wallsLeft;
+      }
+
+      *record++ = (uint8_t) walls.size();
+
+      for (auto& w : walls)
+      {
+         WallState wall = w.rotate(rotations);
+         *record++ = (uint8_t) wall.position.x;
+         *record++ = (uint8_t) wall.position.y;
+         *record++ = (uint8_t) wall.orientation;
+      }
+   }
+
+   /** Rebuilds a board from its compact binary form. The derived views are recomputed. */
+   std::shared_ptr<BoardSnapshot> BoardSnapshot::decode(const uint8_t* data, size_t size)
+   {
+      const size_t headerSize = 7 + PlayerAction::ENCODED_SIZE;
+
+      if (size < headerSize or (data[4] != 2 and data[4] != 4) or size < headerSize + data[4] * 4 + 1)
+      {
+         throw util::Exception("Invalid board snapshot");
+      }
+
+      uint8_t players = data[4];
+      auto snapshot = std::make_shared<BoardSnapshot>(players);
+
+      snapshot->mVersion = readUint32(data);
+      snapshot->mFinished = data[5];
+      snapshot->mWinner = data[6];
+      snapshot->mLastAction.decode(data + 7);
+      snapshot->mBitBoard = BitBoard();
+
+      const uint8_t* record = data + headerSize;
+
+      for (uint8_t i = 0; i < players; ++i, record += 4)
+      {
+         PlayerState& p = snapshot->mPlayers[i];
+         p.position = Position(int8_t(record[1]), int8_t(record[2]));
+
+         if (record[0] > (uint8_t) Direction::Left or not BitBoard::isOnBoard(p.position))
+         {
+            throw util::Exception("Invalid board snapshot");
+         }
+
+         p.initialState = (Direction) record[0];
+         p.wallsLeft = record[3];
+         snapshot->mBitBoard.setPlayer(i, p.position, p.initialState);
+      }
+
+      uint8_t walls = *record++;
+
+      if (size != size_t(record - data) + walls * 3)
+      {
+         throw util::Exception("Invalid board snapshot");
+      }
+
+      for (uint8_t i = 0; i < walls; ++i, record += 3)
+      {
+         WallState w;
+         w.position = Position(int8_t(record[0]), int8_t(record[1]));
+         w.orientation = (Orientation) record[2];
+
+         if (record[2] > (uint8_t) Orientation::Horizontal or not BitBoard::isWallOnBoard(w))
+         {
+            throw util::Exception("Invalid board snapshot");
+         }
+
+         snapshot->mBitBoard.placeWall(w);
+
+         for (uint8_t v = 0; v < players; ++v)
+         {
+            snapshot->mWallViews[v].push_back(w.rotate(static_cast<int>(snapshot->mPlayers[v].initialState)));
+         }
+      }
+
+      for (uint8_t i = 0; i < players; ++i)
+      {
+         snapshot->mDistances[i].reset(snapshot->mBitBoard, snapshot->mPlayers[i].initialState);
+      }
+
+      snapshot->updatePlayerViews();
+      snapshot->updateHash(snapshot->mVersion ? (snapshot->mLastAction.playerId + 1) % players : 0);
+
+      return snapshot;
+   }
+
+   /** Sets the specified action on the board, after it has been validated. Replays don't log the actions. */
+   void BoardSnapshot::applyAction(const PlayerAction& action, bool log)
+   {
+      PlayerState &player = mPlayers.at(action.playerId);
+      ++mVersion;
+      mLastAction = action.rotate(4 - static_cast<int>(player.initialState));
+
+      switch (action.actionType)
+      {
+         case ActionType::Move:
+         {
+            mHash ^= ZOBRIST.pawn(action.playerId, BitBoard::square(player.position));
+            player.position = mLastAction.playerPosition;
+            mBitBoard.movePawn(action.playerId, player.position);
+            mHash ^= ZOBRIST.pawn(action.playerId, BitBoard::square(player.position));
+
+            if (log)
+            {
+               LOG_INFO(DOM) << "Moved player " << (int) action.playerId << " to (" << (int) player.position.x << ", " << (int) player.position.y << ")";
+            }
+
+            // Check winning state
+            if (action.playerPosition.x == 0)
+            {
+               mFinished = true;
+               mWinner = action.playerId;
+
+               if (log)
+               {
+                  LOG_INFO(DOM) << "Game finished. Player " << (int) action.playerId << " won.";
+               }
+            }
+
+            break;
+         }
+         case ActionType::Wall:
+         {
+            if (player.wallsLeft)
+            {
+               mHash ^= ZOBRIST.wallsLeft(action.playerId, player.wallsLeft);
+               --player.wallsLeft;
+               mHash ^= ZOBRIST.wallsLeft(action.playerId, player.wallsLeft);
+            }
+
+            for (size_t i = 0; i < mWallViews.size(); ++i)
+            {
+               mWallViews[i].push_back(mLastAction.wallState.rotate(static_cast<int>(mPlayers[i].initialState)));
+            }
+
+            if (BitBoard::isWallOnBoard(mLastAction.wallState))
+            {
+               mBitBoard.placeWall(mLastAction.wallState);
+               mHash ^= ZOBRIST.wall(mLastAction.wallState.orientation, BitBoard::wallSlot(mLastAction.wallState));
+            }
+
+            for (auto& distances : mDistances)
+            {
+               distances.update(mBitBoard, mLastAction.wallState);
+            }
+
+            if (log)
+            {
+               LOG_INFO(DOM) << "Placed wall by player " << (int) action.playerId << " at ("
+                  << (int) mLastAction.wallState.position.x << ", " << (int) mLastAction.wallState.position.y << ", "
+                  << (mLastAction.wallState.orientation == Orientation::Vertical ? "V" : "H") << ")";
+            }
+
+            break;
+         }
+         default:
+            break;
+      }
+
+      mHash ^= ZOBRIST.side(action.playerId) ^ ZOBRIST.side((action.playerId + 1) % mPlayers.size());
+      updatePlayerViews();
+   }
+
+   /** Sets an action of a replayed game, in absolute coordinates. The action isn't validated nor logged. */
+   void BoardSnapshot::replayAction(const PlayerAction& action)
+   {
+      // Actions are applied from the perspective of the player
+      auto initialState = mPlayers.at(action.playerId).initialState;
+      applyAction(action.rotate(static_cast<int>(initialState)), false);
+   }
+
+   /** Force game termination */
+   void BoardSnapshot::endGame()
+   {
+      ++mVersion;
+      mFinished = true;
+   }
+
+   /** Rotates all players for each perspective */
+   void BoardSnapshot::updatePlayerViews()
+   {
+      mPlayerViews.resize(mPlayers.size());
+
+      for (size_t i = 0; i < mPlayers.size(); ++i)
+      {
+         uint8_t rotations = static_cast<int>(mPlayers[i].initialState);
+         mPlayerViews[i].clear();
+
+         for (auto& p : mPlayers)
+         {
+            mPlayerViews[i].push_back(p.rotate(rotations));
+         }
+      }
+   }
+
+   /** Computes the hash of the whole position */
+   void BoardSnapshot::updateHash(PlayerId currentPlayer)
+   {
+      uint8_t wallsLeft[MAX_PLAYERS] = {};
+
+      for (size_t i = 0; i < mPlayers.size(); ++i)
+      {
+         wallsLeft[i] = mPlayers[i].wallsLeft;
+      }
+
+      mHash = ZOBRIST.hash(mBitBoard, wallsLeft, uint8_t(mPlayers.size()), currentPlayer);
+   }
+} // namespace qcore
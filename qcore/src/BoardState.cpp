@@ -7,9 +7,6 @@ using namespace qcore::literals;
 
 namespace qcore
 {
-   /** Log domain */
-   const char * const DOM = "qcore::BS";
-
    BoardMap::BoardMap(const BoardMap &from)
    {
       std::memcpy(map, from.map, sizeof(map));
@@ -56,54 +53,14 @@ namespace qcore
 
    /** Construction */
    BoardState::BoardState(uint8_t players, uint8_t walls) :
-      mFinished(false),
-      mWinner(0xFF)
+      mSnapshot(std::make_shared<BoardSnapshot>(players, walls))
    {
-      mPlayers.resize(players);
-
-      // Set initial player position
-      if (players == 2)
-      {
-         if (walls == 0)
-         {
-            walls = 10;
-         }
-
-         mPlayers[0].position = { BOARD_SIZE - 1, BOARD_SIZE / 2 };
-         mPlayers[0].initialState = Direction::Down;
-         mPlayers[0].wallsLeft = walls;
-
-         mPlayers[1].position = { 0, BOARD_SIZE / 2 };
-         mPlayers[1].initialState = Direction::Up;
-         mPlayers[1].wallsLeft = walls;
-      }
-      else if (players == 4)
-      {
-         if (walls == 0)
-         {
-            walls = 5;
-         }
-
-         mPlayers[0].position = { BOARD_SIZE - 1, BOARD_SIZE / 2 };
-         mPlayers[0].initialState = Direction::Down;
-         mPlayers[0].wallsLeft = walls;
-
-         mPlayers[1].position = { BOARD_SIZE / 2, BOARD_SIZE - 1 };
-         mPlayers[1].initialState = Direction::Right;
-         mPlayers[1].wallsLeft = walls;
-
-         mPlayers[2].position = { 0, BOARD_SIZE / 2 };
-         mPlayers[2].initialState = Direction::Up;
-         mPlayers[2].wallsLeft = walls;
+   }
 
-         mPlayers[3].position = { BOARD_SIZE / 2, 0 };
-         mPlayers[3].initialState = Direction::Left;
-         mPlayers[3].wallsLeft = walls;
-      }
-      else
-      {
-         throw util::Exception( "Invalid number of players" );
-      }
+   /** Construction over an existing snapshot, without any state change callbacks */
+   BoardState::BoardState(BoardSnapshotPtr snapshot) :
+      mSnapshot(snapshot)
+   {
    }
 
    /** Registers callback for state change notification */
@@ -112,123 +69,112 @@ namespace qcore
       mStateChangeCb.push_back(cb);
    }
 
+   /** Returns the current snapshot of the board. It remains valid and unchanged after later updates. */
+   BoardSnapshotPtr BoardState::getSnapshot() const
+   {
+      return std::atomic_load(&mSnapshot);
+   }
+
    /** Get wall states from the player's perspective */
    std::list<WallState> BoardState::getWalls(const PlayerId id) const
    {
-      std::lock_guard<std::mutex> lock(mMutex);
-      std::list<WallState> walls;
-      uint8_t rotations = static_cast<int>(mPlayers.at(id).initialState);
+      auto snapshot = getSnapshot();
+      auto& walls = snapshot->getWalls(id);
 
-      for ( auto& w : mWalls )
-      {
-         walls.push_back(w.rotate(rotations));
-      }
-
-      return walls;
+      return std::list<WallState>(walls.begin(), walls.end());
    }
 
    /** Get player states from the player's perspective */
    std::vector<PlayerState> BoardState::getPlayers(const PlayerId id) const
    {
-      std::lock_guard<std::mutex> lock(mMutex);
-      std::vector<PlayerState> players;
-      uint8_t rotations = static_cast<int>(mPlayers.at(id).initialState);
-
-      for ( auto& p : mPlayers )
-      {
-         players.push_back(p.rotate(rotations));
-      }
-
-      return players;
+      return getSnapshot()->getPlayers(id);
    }
 
    /** Check if the specified space is occupied by a pawn */
    bool BoardState::isSpaceEmpty(const Position& position, const PlayerId id) const
    {
-      std::lock_guard<std::mutex> lock(mMutex);
-      uint8_t rotations = static_cast<int>(mPlayers.at(id).initialState);
+      return getSnapshot()->isSpaceEmpty(position, id);
+   }
 
-      for (auto &player : mPlayers)
-      {
-         if (player.rotate(rotations).position == position)
-         {
-            return false;
-         }
-      }
+   /** Returns the number of walls left for the specified player */
+   uint8_t BoardState::getWallsLeft(const PlayerId id) const
+   {
+      return getSnapshot()->getWallsLeft(id);
+   }
+
+   /** Returns the compact board representation, in absolute coordinates */
+   BitBoard BoardState::getBitBoard() const
+   {
+      return getSnapshot()->getBitBoard();
+   }
+
+   /** Returns the number of steps the player needs to reach its goal, ignoring other pawns */
+   uint8_t BoardState::getGoalDistance(const PlayerId player) const
+   {
+      return getSnapshot()->getGoalDistance(player);
+   }
 
-      return true;
+   /** Returns the number of steps from the specified position to player's goal, ignoring other pawns */
+   uint8_t BoardState::getGoalDistance(const PlayerId player, const Position& position, const PlayerId id) const
+   {
+      return getSnapshot()->getGoalDistance(player, position, id);
+   }
+
+   /** Returns the distances to goal of the specified player, in absolute coordinates */
+   DistanceMap BoardState::getDistanceMap(const PlayerId player) const
+   {
+      return getSnapshot()->getDistanceMap(player);
    }
 
    /** Flags if the game has finished */
    bool BoardState::isFinished() const
    {
-      std::lock_guard<std::mutex> lock(mMutex);
-      return mFinished;
+      return getSnapshot()->isFinished();
    }
 
    /** Returns the ID of the player who won the game. Valid only when the game has finished. */
    PlayerId BoardState::getWinner() const
    {
-      std::lock_guard<std::mutex> lock(mMutex);
-      return mWinner;
+      return getSnapshot()->getWinner();
    }
 
    /** Returns the last action made */
    PlayerAction BoardState::getLastAction() const
    {
-      std::lock_guard<std::mutex> lock(mMutex);
-      return mLastAction;
+      return getSnapshot()->getLastAction();
+   }
+
+   /** Returns the Zobrist hash of the position */
+   uint64_t BoardState::getHash() const
+   {
+      return getSnapshot()->getHash();
    }
 
    /** Sets the specified action on the board, after it has been validated */
    void BoardState::applyAction(const PlayerAction& action)
    {
       std::lock_guard<std::mutex> lock(mMutex);
-      PlayerState &player = mPlayers.at(action.playerId);
-      mLastAction = action.rotate(4 - static_cast<int>(player.initialState));
+      auto next = std::make_shared<BoardSnapshot>(*getSnapshot());
 
-      switch (action.actionType)
-      {
-         case ActionType::Move:
-         {
-            player.position = mLastAction.playerPosition;
-            LOG_INFO(DOM) << "Moved player " << (int) action.playerId << " to (" << (int) player.position.x << ", " << (int) player.position.y << ")";
-
-            // Check winning state
-            if (action.playerPosition.x == 0)
-            {
-               mFinished = true;
-               mWinner = action.playerId;
-               LOG_INFO(DOM) << "Game finished. Player " << (int) action.playerId << " won.";
-            }
-
-            break;
-         }
-         case ActionType::Wall:
-         {
-            if (player.wallsLeft)
-            {
-               --player.wallsLeft;
-            }
-
-            mWalls.push_back(mLastAction.wallState);
-
-            LOG_INFO(DOM) << "Placed wall by player " << (int) action.playerId << " at ("
-               << (int) mLastAction.wallState.position.x << ", " << (int) mLastAction.wallState.position.y << ", "
-               << (mLastAction.wallState.orientation == Orientation::Vertical ? "V" : "H") << ")";
-
-            break;
-         }
-         default:
-            break;
-      }
+      next->applyAction(action);
+      publish(next);
    }
 
    /** Force game termination */
    void BoardState::endGame()
    {
       std::lock_guard<std::mutex> lock(mMutex);
-      mFinished = true;
+      auto next = std::make_shared<BoardSnapshot>(*getSnapshot());
+
+      next->endGame();
+      publish(next);
+   }
+
+   /** Replaces the whole board, with a snapshot received from a remote game */
+   void BoardState::load(BoardSnapshotPtr snapshot)
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      publish(snapshot);
    }
 
    /**
@@ -245,8 +191,9 @@ namespace qcore
          }
       }
 
-      auto walls = getWalls(id);
-      auto players = getPlayers(id);
+      auto snapshot = getSnapshot();
+      auto& walls = snapshot->getWalls(id);
+      auto& players = snapshot->getPlayers(id);
 
       for (auto& w : walls)
       {
@@ -276,4 +223,10 @@ namespace qcore
          cb();
       }
    }
+
+   /** Makes the new snapshot visible to all readers */
+   void BoardState::publish(BoardSnapshotPtr snapshot)
+   {
+      std::atomic_store(&mSnapshot, snapshot);
+   }
 } // namespace qcore
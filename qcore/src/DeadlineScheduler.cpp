@@ -0,0 +1,114 @@
+#include "DeadlineScheduler.h"
+#include "QcoreUtil.h"
+
+namespace qcore
+{
+   /** Log domain */
+   const char * const DOM = "qcore::DS";
+
+   /** Construction */
+   DeadlineScheduler::DeadlineScheduler() :
+      mNextId(INVALID_TIMER + 1),
+      mStopped(false),
+      mThread(&DeadlineScheduler::run, this)
+   {
+   }
+
+   /** Destruction. Pending callbacks are dropped. */
+   DeadlineScheduler::~DeadlineScheduler()
+   {
+      {
+         std::lock_guard<std::mutex> lock(mMutex);
+         mStopped = true;
+      }
+
+      mCv.notify_all();
+      mThread.join();
+   }
+
+   /** Returns the scheduler shared by all games of the process */
+   std::shared_ptr<DeadlineScheduler> DeadlineScheduler::Shared()
+   {
+      static std::shared_ptr<DeadlineScheduler> scheduler = std::make_shared<DeadlineScheduler>();
+      return scheduler;
+   }
+
+   /** Schedules a callback to be called once the deadline expires */
+   DeadlineScheduler::TimerId DeadlineScheduler::schedule(Clock::time_point deadline, Callback callback)
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      TimerId timer = mNextId++;
+
+      mTimers.emplace(std::make_pair(deadline, timer), std::move(callback));
+      mDeadlines.emplace(timer, deadline);
+
+      // Wake up the thread only if it sleeps past the new deadline
+      if (mTimers.begin()->first.second == timer)
+      {
+         mCv.notify_one();
+      }
+
+      return timer;
+   }
+
+   /**
+    * Cancels a pending callback
+    * @return false if the callback was already called, or is running
+    */
+   bool DeadlineScheduler::cancel(TimerId timer)
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      auto it = mDeadlines.find(timer);
+
+      if (it == mDeadlines.end())
+      {
+         return false;
+      }
+
+      // No need to wake up the thread, it will find nothing to do at the old deadline
+      mTimers.erase(std::make_pair(it->second, timer));
+      mDeadlines.erase(it);
+
+      return true;
+   }
+
+   /** Scheduler thread loop */
+   void DeadlineScheduler::run()
+   {
+      std::unique_lock<std::mutex> lock(mMutex);
+
+      while (not mStopped)
+      {
+         if (mTimers.empty())
+         {
+            mCv.wait(lock);
+            continue;
+         }
+
+         auto first = mTimers.begin();
+
+         if (Clock::now() < first->first.first)
+         {
+            mCv.wait_until(lock, first->first.first);
+            continue;
+         }
+
+         Callback callback = std::move(first->second);
+         mDeadlines.erase(first->first.second);
+         mTimers.erase(first);
+
+         lock.unlock();
+
+         try
+         {
+            callback();
+         }
+         catch (std::exception& e)
+         {
+            LOG_ERROR(DOM) << "Timer callback failed: " << e.what();
+         }
+
+         lock.lock();
+      }
+   }
+} // namespace qcore
@@ -0,0 +1,239 @@
+#include "DistanceMap.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace qcore
+{
+   /** All step directions */
+   static const Direction DIRECTIONS[] = { Direction::Up, Direction::Down, Direction::Left, Direction::Right };
+
+   /** Construction. All squares are unreachable until reset. */
+   DistanceMap::DistanceMap() :
+      mInitialState(Direction::Down)
+   {
+      std::memset(mDist, UNREACHABLE, sizeof(mDist));
+   }
+
+   /** Recomputes all distances for the specified board */
+   void DistanceMap::reset(const BitBoard& board, Direction initialState)
+   {
+      uint8_t queue[BOARD_SQUARES];
+      uint8_t head = 0;
+      uint8_t tail = 0;
+
+      mInitialState = initialState;
+      std::memset(mDist, UNREACHABLE, sizeof(mDist));
+
+      for (uint8_t sq = 0; sq < BOARD_SQUARES; ++sq)
+      {
+         if (BitBoard::isGoal(BitBoard::position(sq), mInitialState))
+         {
+            mDist[sq] = 0;
+            queue[tail++] = sq;
+         }
+      }
+
+      while (head != tail)
+      {
+         uint8_t sq = queue[head++];
+         Position p = BitBoard::position(sq);
+
+         for (Direction d : DIRECTIONS)
+         {
+            if (not board.isBlocked(p, d))
+            {
+               uint8_t next = BitBoard::square(p + d);
+
+               if (mDist[next] == UNREACHABLE)
+               {
+                  mDist[next] = mDist[sq] + 1;
+                  queue[tail++] = next;
+               }
+            }
+         }
+      }
+   }
+
+   /** Updates the distances after the specified wall was placed on the board */
+   void DistanceMap::update(const BitBoard& board, const WallState& wall)
+   {
+      if (not BitBoard::isWallOnBoard(wall))
+      {
+         return;
+      }
+
+      bool invalid[BOARD_SQUARES] = {};
+      bool queued[BOARD_SQUARES] = {};
+      uint8_t queue[BOARD_SQUARES];
+      uint8_t head = 0;
+      uint8_t count = 0;
+
+      uint8_t affected[BOARD_SQUARES];
+      uint8_t affectedCount = 0;
+
+      auto push = [&](uint8_t sq)
+      {
+         if (not queued[sq])
+         {
+            queued[sq] = true;
+            queue[(head + count++) % BOARD_SQUARES] = sq;
+         }
+      };
+
+      // A square may lose its distance only if its shortest path went through one of the cut edges
+      auto checkEdge = [&](const Position& from, const Position& to)
+      {
+         uint8_t f = BitBoard::square(from);
+         uint8_t t = BitBoard::square(to);
+
+         if (mDist[f] != UNREACHABLE and mDist[f] == mDist[t] + 1)
+         {
+            push(f);
+         }
+      };
+
+      uint8_t slot = BitBoard::wallSlot(wall);
+      Position mid(slot / WALL_SLOTS, slot % WALL_SLOTS);
+      Position across = wall.orientation == Orientation::Vertical ? Position(0, 1) : Position(1, 0);
+      Position along = wall.orientation == Orientation::Vertical ? Position(1, 0) : Position(0, 1);
+
+      checkEdge(mid, mid + across);
+      checkEdge(mid + across, mid);
+      checkEdge(mid + along, mid + along + across);
+      checkEdge(mid + along + across, mid + along);
+
+      // Invalidate all squares left without a neighbor one step closer to the goal
+      while (count)
+      {
+         uint8_t sq = queue[head];
+         head = (head + 1) % BOARD_SQUARES;
+         --count;
+         queued[sq] = false;
+
+         if (invalid[sq] or mDist[sq] == 0)
+         {
+            continue;
+         }
+
+         Position p = BitBoard::position(sq);
+         bool supported = false;
+
+         for (Direction d : DIRECTIONS)
+         {
+            if (not board.isBlocked(p, d))
+            {
+               uint8_t next = BitBoard::square(p + d);
+               supported = supported or (not invalid[next] and mDist[next] + 1 == mDist[sq]);
+            }
+         }
+
+         if (supported)
+         {
+            continue;
+         }
+
+         invalid[sq] = true;
+         affected[affectedCount++] = sq;
+
+         for (Direction d : DIRECTIONS)
+         {
+            if (not board.isBlocked(p, d))
+            {
+               uint8_t next = BitBoard::square(p + d);
+
+               if (not invalid[next] and mDist[next] != UNREACHABLE and mDist[next] == mDist[sq] + 1)
+               {
+                  push(next);
+               }
+            }
+         }
+      }
+
+      if (not affectedCount)
+      {
+         return;
+      }
+
+      // Seed the invalidated squares from their valid neighbors
+      uint8_t tentative[BOARD_SQUARES];
+      uint8_t seeds[BOARD_SQUARES];
+      uint8_t seedCount = 0;
+
+      for (uint8_t i = 0; i < affectedCount; ++i)
+      {
+         mDist[affected[i]] = UNREACHABLE;
+      }
+
+      for (uint8_t i = 0; i < affectedCount; ++i)
+      {
+         uint8_t sq = affected[i];
+         Position p = BitBoard::position(sq);
+         tentative[sq] = UNREACHABLE;
+
+         for (Direction d : DIRECTIONS)
+         {
+            if (not board.isBlocked(p, d))
+            {
+               uint8_t next = BitBoard::square(p + d);
+
+               if (not invalid[next] and mDist[next] != UNREACHABLE and mDist[next] + 1 < tentative[sq])
+               {
+                  tentative[sq] = mDist[next] + 1;
+               }
+            }
+         }
+
+         if (tentative[sq] != UNREACHABLE)
+         {
+            seeds[seedCount++] = sq;
+         }
+      }
+
+      std::sort(seeds, seeds + seedCount, [&](uint8_t a, uint8_t b) { return tentative[a] < tentative[b]; });
+
+      // Breadth first search over the invalidated squares, merging the sorted seeds into the queue
+      uint8_t tail = 0;
+      uint8_t nextSeed = 0;
+      head = 0;
+
+      while (nextSeed < seedCount or head != tail)
+      {
+         uint8_t sq;
+
+         if (head != tail and (nextSeed == seedCount or mDist[queue[head]] <= tentative[seeds[nextSeed]]))
+         {
+            sq = queue[head++];
+         }
+         else
+         {
+            sq = seeds[nextSeed++];
+
+            if (not invalid[sq])
+            {
+               continue;
+            }
+
+            invalid[sq] = false;
+            mDist[sq] = tentative[sq];
+         }
+
+         Position p = BitBoard::position(sq);
+
+         for (Direction d : DIRECTIONS)
+         {
+            if (not board.isBlocked(p, d))
+            {
+               uint8_t next = BitBoard::square(p + d);
+
+               if (invalid[next] and mDist[sq] + 1 < tentative[next])
+               {
+                  invalid[next] = false;
+                  mDist[next] = tentative[next] = mDist[sq] + 1;
+                  queue[tail++] = next;
+               }
+            }
+         }
+      }
+   }
+} // namespace qcore
@@ -6,8 +6,6 @@
 #include <cstring>
 #include <sstream>
 
-using namespace qcore::literals;
-
 namespace qcore
 {
    /** Log domain */
@@ -16,6 +14,8 @@ namespace qcore
    /** Construction */
    Game::Game(uint8_t players) :
       mNumberOfPlayers(players),
+      mGameId(INVALID_GAME_ID),
+      mHistory(players),
       mBoardState(std::make_shared<BoardState>(players)),
       mCurrentPlayer(0)
    {
@@ -24,6 +24,8 @@ namespace qcore
    Game::Game(const Game& g) :
        mNumberOfPlayers(g.mNumberOfPlayers),
        mGameServer(g.mGameServer),
+       mGameId(g.mGameId),
+       mHistory(g.getHistory()),
        mBoardState(std::make_shared<BoardState>(*g.mBoardState)),
        mCurrentPlayer(g.mCurrentPlayer)
    {
@@ -34,16 +36,27 @@ namespace qcore
    {
        mNumberOfPlayers = g.mNumberOfPlayers;
        mGameServer = g.mGameServer;
+       mGameId = g.mGameId;
+       mHistory = g.getHistory();
        mBoardState = std::make_shared<BoardState>(*g.mBoardState);
        mCurrentPlayer = g.mCurrentPlayer;
 
        return *this;
    }
 
-   void Game::setGameServer(std::shared_ptr<GameServer> gameServer)
+   /** Sets the game server hosting the game, and the game ID on the server */
+   void Game::setGameServer(std::shared_ptr<GameServer> gameServer, GameId gameId)
    {
       std::lock_guard<std::mutex> lock(mMutex);
       mGameServer = gameServer;
+      mGameId = gameId;
+   }
+
+   /** Sets the function called after each valid move and when the game ends, from the thread making the change */
+   void Game::setMoveListener(std::function<void()> listener)
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mMoveListener = listener;
    }
 
    /** Returns the ID of the player on move */
@@ -53,6 +66,36 @@ namespace qcore
       return mCurrentPlayer;
    }
 
+   /** Returns the actions applied since the start of the game, in absolute coordinates */
+   std::vector<PlayerAction> Game::getActions() const
+   {
+      return getHistory().getActions();
+   }
+
+   /** Returns the history of the game. It remains unchanged after later actions. */
+   BoardHistory Game::getHistory() const
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      return mHistory;
+   }
+
+   /** Restarts the game from the end of the specified history, with the next player on move */
+   void Game::load(const BoardHistory& history)
+   {
+      if (history.getNumberOfPlayers() != mNumberOfPlayers)
+      {
+         throw util::Exception("History of a game with " + std::to_string(history.getNumberOfPlayers()) + " players");
+      }
+
+      auto board = history.getSnapshot();
+
+      std::lock_guard<std::mutex> lock(mMutex);
+      mHistory = history;
+      mBoardState->load(board);
+      mCurrentPlayer = history.size() ? (history.getLastAction().playerId + 1) % mNumberOfPlayers : 0;
+      mCv.notify_all();
+   }
+
    /** Waits until the specified player has picked his move */
    void Game::waitPlayerMove(PlayerId playerId)
    {
@@ -73,7 +116,7 @@ namespace qcore
    /** Validates and sets the next user action */
    bool Game::processPlayerAction(const PlayerAction& action, std::string& reason)
    {
-      std::lock_guard<std::mutex> lock(mMutex);
+      std::unique_lock<std::mutex> lock(mMutex);
 
       if (action.actionType == ActionType::Move)
       {
@@ -103,25 +146,56 @@ namespace qcore
          return false;
       }
 
+      // Set the action
+      mBoardState->applyAction(action);
+      auto board = mBoardState->getSnapshot();
+      mHistory = mHistory.push(board->getLastAction(), board);
+
 #ifdef BOOST_AVAILABLE
-      // Notify all remote boards of the state change
+      // Notify all remote boards of the state change. Sent after the action is applied, so a
+      // snapshot taken by a joining spectator is never older than the updates it misses.
       if (mGameServer)
       {
          LOG_DEBUG(DOM) << "Notify remote players of state change ...";
-         mGameServer->send(std::string{ GameServer::BoardStateUpdate } + action.serialize());
+         uint8_t update[sizeof(uint32_t) + PlayerAction::ENCODED_SIZE];
+         writeUint32(update, mBoardState->getSnapshot()->getVersion());
+         action.encode(update + sizeof(uint32_t));
+         mGameServer->send(mGameId, GameServer::BoardStateUpdate, update, sizeof(update));
       }
 #endif
 
-      // Set the action
-      mBoardState->applyAction(action);
-
       // Update player's turn
       nextPlayer();
       mCv.notify_all();
 
+      // The listener may query the game
+      auto listener = mMoveListener;
+      lock.unlock();
+
+      if (listener)
+      {
+         listener();
+      }
+
       return true;
    }
 
+   /** Returns the direction of a one square step */
+   static Direction stepDirection(const Position& from, const Position& to)
+   {
+      if (to.x < from.x)
+      {
+         return Direction::Up;
+      }
+
+      if (to.x > from.x)
+      {
+         return Direction::Down;
+      }
+
+      return to.y < from.y ? Direction::Left : Direction::Right;
+   }
+
    /** Check if player's action is valid */
    bool Game::isActionValid(const PlayerAction& action, std::string& reason) const
    {
@@ -134,34 +208,36 @@ namespace qcore
             throw util::Exception("Invalid action structure");
          }
 
-         if (getBoardState()->isFinished())
+         auto snapshot = mBoardState->getSnapshot();
+
+         if (snapshot->isFinished())
          {
             throw util::Exception("Game finished. Please restart another game.");
          }
 
-         BoardMap map;
-         mBoardState->createBoardMap(map, action.playerId);
+         // All checks are done in absolute coordinates
+         BitBoard board = snapshot->getBitBoard();
+         uint8_t rotations = 4 - static_cast<int>(board.getInitialState(action.playerId));
 
          if (action.actionType == ActionType::Move)
          {
-            Position currentPos = mBoardState->getPlayers(action.playerId).at(action.playerId).position;
-            Position p1 = currentPos * 2;
-            Position p2 = action.playerPosition * 2;
-            uint8_t dist = action.playerPosition.dist(currentPos);
-
-            if (map(p2) == BoardMap::Invalid)
+            if (not BitBoard::isOnBoard(action.playerPosition))
             {
                ss << "Illegal move player " << (int) action.playerId << ": Cannot move outside board's boundaries!";
                throw util::Exception(ss.str());
             }
 
+            Position p1 = board.getPawn(action.playerId);
+            Position p2 = action.playerPosition.rotate(rotations);
+            uint8_t dist = p2.dist(p1);
+
             if (p1 == p2)
             {
                ss << "Illegal move player " << (int) action.playerId << ": Same place as before!";
                throw util::Exception(ss.str());
             }
 
-            if (map(p2))
+            if (board.isPawn(p2))
             {
                ss << "Illegal move player " << (int) action.playerId << ": Space occupied!";
                throw util::Exception(ss.str());
@@ -169,7 +245,7 @@ namespace qcore
 
             if (dist == 1)
             {
-               if (map((p1 + p2) / 2))
+               if (board.isBlocked(p1, stepDirection(p1, p2)))
                {
                   ss << "Illegal move player " << (int) action.playerId << ": You cannot jump over a wall!";
                   throw util::Exception(ss.str());
@@ -177,36 +253,20 @@ namespace qcore
             }
             else if (dist == 2)
             {
-               // Jump over another pawn
-               if (p1.x == p2.x)
+               if (p1.x == p2.x or p1.y == p2.y)
                {
-                  int8_t mid = (p1.y + p2.y) / 2;
+                  // Jump over another pawn
+                  Direction d = stepDirection(p1, p2);
+                  Position mid = p1 + d;
 
                   // There's no wall between
-                  if (map(p1.x, mid - 1) or map(p1.x, mid + 1))
+                  if (board.isBlocked(p1, d) or board.isBlocked(mid, d))
                   {
                      ss << "Illegal move player " << (int) action.playerId << ": You cannot jump over a wall!";
                      throw util::Exception(ss.str());
                   }
 
-                  if (not map(p1.x, mid))
-                  {
-                     ss << "Illegal move player " << (int) action.playerId << ": You can move only one space!";
-                     throw util::Exception(ss.str());
-                  }
-               }
-               else if (p1.y == p2.y)
-               {
-                  int8_t mid = (p1.x + p2.x) / 2;
-
-                  // There's no wall between
-                  if (map(mid - 1, p1.y) or map(mid + 1, p1.y))
-                  {
-                     ss << "Illegal move player " << (int) action.playerId << ": You cannot jump over a wall!";
-                     throw util::Exception(ss.str());
-                  }
-
-                  if (not map(mid, p1.y))
+                  if (not board.isPawn(mid))
                   {
                      ss << "Illegal move player " << (int) action.playerId << ": You can move only one space!";
                      throw util::Exception(ss.str());
@@ -215,14 +275,14 @@ namespace qcore
                else
                {
                   // If there is a wall or a third pawn behind the second pawn, the player can place his pawn to the left or the right of the other pawn
-                  Position mid1(p1.x, p2.y);
-                  Position diff1 = p1 - mid1;
-
-                  Position mid2(p2.x, p1.y);
-                  Position diff2 = p1 - mid2;
+                  auto sideStep = [&](const Position& mid)
+                  {
+                     return board.isPawn(mid) and
+                        not board.isBlocked(p1, stepDirection(p1, mid)) and
+                        not board.isBlocked(mid, stepDirection(mid, p2));
+                  };
 
-                  if ((not map.isPawn(mid1) or map((p1 + mid1)/2) or map((p2 + mid1) / 2) or (map(mid1 + diff1 / 2) == 0 and not map.isPawn(mid1 + diff1))) and
-                     (not map.isPawn(mid2) or map((p1 + mid2)/2) or map((p2 + mid2) / 2) or (map(mid2 + diff2 / 2) == 0 and not map.isPawn(mid2 + diff2))))
+                  if (not sideStep(Position(p1.x, p2.y)) and not sideStep(Position(p2.x, p1.y)))
                   {
                      ss << "Illegal move player " << (int) action.playerId << ": You can move only one space!";
                      throw util::Exception(ss.str());
@@ -238,55 +298,34 @@ namespace qcore
          else
          {
             // Check number of walls left
-            if (mBoardState->getPlayers(action.playerId).at(action.playerId).wallsLeft == 0)
+            if (snapshot->getWallsLeft(action.playerId) == 0)
             {
                ss << "Illegal move player " << (int) action.playerId << ": No more walls left!";
                throw util::Exception(ss.str());
             }
 
             // Check board limits
-            if (action.wallState.position.x >= BOARD_SIZE or action.wallState.position.y >= BOARD_SIZE or
-               action.wallState.position.x < 0 or action.wallState.position.y < 0 or
-               (action.wallState.position.x == 0 and action.wallState.position.y == 0) or
-               (action.wallState.position.x == 0 and action.wallState.orientation == Orientation::Horizontal) or
-               (action.wallState.position.y == 0 and action.wallState.orientation == Orientation::Vertical) or
-               (action.wallState.position.x == BOARD_SIZE - 1 and action.wallState.orientation == Orientation::Vertical) or
-               (action.wallState.position.y == BOARD_SIZE - 1 and action.wallState.orientation == Orientation::Horizontal))
+            if (not BitBoard::isWallOnBoard(action.wallState))
             {
                ss << "Illegal move player " << (int) action.playerId << ": Wall outside board's boundaries!";
                throw util::Exception(ss.str());
             }
 
             // Check if it is not intersecting other wall
-            if (action.wallState.orientation == Orientation::Vertical)
-            {
-               Position p = action.wallState.position * 2 - 1_y;
-
-               if (map(p) or map(p + 1_x) != BoardMap::MidWall or map(p + 2_x))
-               {
-                  ss << "Illegal move player " << (int) action.playerId << ": Intersecting another wall!";
-                  throw util::Exception(ss.str());
-               }
+            WallState wall = action.wallState.rotate(rotations);
 
-               map(p) = map(p + 1_x) = map(p + 2_x) = BoardMap::VertivalWall;
-            }
-            else
+            if (board.isWallIntersecting(wall))
             {
-               Position p = action.wallState.position * 2 - 1_x;
-
-               if (map(p) or map(p + 1_y) != BoardMap::MidWall or map(p + 2_y))
-               {
-                  ss << "Illegal move player " << (int) action.playerId << ": Intersecting another wall!";
-                  throw util::Exception(ss.str());
-               }
-
-               map(p) = map(p + 1_y) = map(p + 2_y) = BoardMap::HorizontalWall;
+               ss << "Illegal move player " << (int) action.playerId << ": Intersecting another wall!";
+               throw util::Exception(ss.str());
             }
 
+            board.placeWall(wall);
+
             // Check if the wall isn't blocking a pawn's path
             for (PlayerId pId = 0; pId < mNumberOfPlayers; ++pId)
             {
-               if (not checkPlayerPath(pId, action))
+               if (not checkPlayerPath(pId, board))
                {
                   ss << "Illegal move player " << (int) action.playerId << ": Wall blocking player's " << (int) pId << " path!";
                   throw util::Exception(ss.str());
@@ -304,62 +343,9 @@ namespace qcore
    }
 
    /** Checks if the player's path isn't blocked */
-   bool Game::checkPlayerPath(const PlayerId playerId, const PlayerAction& action) const
+   bool Game::checkPlayerPath(const PlayerId playerId, const BitBoard& board) const
    {
-      auto players = mBoardState->getPlayers(playerId);
-      auto currentPos = players.at(playerId).position * 2;
-      std::list<Position> pos { currentPos };
-      BoardMap map;
-
-      getBoardState()->createBoardMap(map, playerId);
-      map(currentPos) = BoardMap::Invalid;
-
-      // Place the wall
-      auto wall = action.wallState.rotate(4 - static_cast<int>(players.at(action.playerId).initialState));
-
-      if (wall.orientation == Orientation::Vertical)
-      {
-         Position p = wall.position * 2 - 1_y;
-         map(p) = map(p + 1_x) = map(p + 2_x) = BoardMap::VertivalWall;
-      }
-      else
-      {
-         Position p = wall.position * 2 - 1_x;
-         map(p) = map(p + 1_y) = map(p + 2_y) = BoardMap::HorizontalWall;
-      }
-
-      // Check the path
-      auto checkPos = [&](const Position& p) -> bool
-      {
-         if (p.x == 0)
-         {
-            return true;
-         }
-
-         if(map(p) < BoardMap::HorizontalWall)
-         {
-            map(p) = BoardMap::Invalid;
-            pos.emplace_back(p);
-         }
-
-         return false;
-      };
-
-      while (not pos.empty())
-      {
-         auto p = pos.front();
-         pos.pop_front();
-
-         if ((map(p + 1_x) == 0 and checkPos(p + 2_x)) or
-            (map(p - 1_x) == 0 and checkPos(p - 2_x)) or
-            (map(p + 1_y) == 0 and checkPos(p + 2_y)) or
-            (map(p - 1_y) == 0 and checkPos(p - 2_y)))
-         {
-            return true;
-         }
-      }
-
-      return false;
+      return board.hasPathToGoal(playerId);
    }
 
    void Game::nextPlayer()
@@ -376,8 +362,20 @@ namespace qcore
 
    void Game::end()
    {
+      std::function<void()> listener;
+
+      {
+         std::lock_guard<std::mutex> lock(mMutex);
+         listener = mMoveListener;
+      }
+
       mBoardState->endGame();
       mCv.notify_all();
+
+      if (listener)
+      {
+         listener();
+      }
    }
 
 } // namespace qcore
@@ -6,6 +6,9 @@
 #include "GameServer.h"
 #include "RemoteGame.h"
 #include "RemotePlayer.h"
+#include "ThreadPool.h"
+
+#include <atomic>
 
 using namespace std::chrono_literals;
 
@@ -18,36 +21,85 @@ namespace qcore
    const auto PLAYER_MIN_TIME_MS = 1000ms;
    const auto PLAYER_MOVE_TIMEOUT_MS = 5000ms;
 
+   /** Spreads the games of different controllers over the workers of the executor */
+   static std::atomic<size_t> NextAffinity(0);
+
    /** Construction */
    GameController::GameController(const std::string&) :
+      mHostedGameId(INVALID_GAME_ID),
+      mMinMoveTime(PLAYER_MIN_TIME_MS),
+      mAffinity(NextAffinity++),
+      mTimer(DeadlineScheduler::INVALID_TIMER),
+      mMovingPlayer(0),
       mMoveInProgress(false),
+      mTimedOutPlayer(0xFF),
+      mPendingMoves(0),
+      mRunning(false),
+      mOneStep(false),
+      mWatchdogDisabled(false),
       mIsRemoteGame(false)
    {
+      mDefaultTimeControl.moveLimit = PLAYER_MOVE_TIMEOUT_MS;
+
       LOG_INIT("quoridor.log");
       LOG_INFO(DOM) << "Initializing GameController ...";
 
-      PluginManager::LoadPlayerLibraries();
+      // Shared workers are created after the log, so they are destroyed (and joined) before it
+      mExecutor = ThreadPool::Shared();
+      mScheduler = DeadlineScheduler::Shared();
 
-#ifdef BOOST_AVAILABLE
-      mGameServer = std::make_shared<GameServer>(*this);
-#endif
+      PluginManager::LoadPlayerLibraries();
 
       // TODO Parse config params
    }
 
-   /** Initializes a new remote game */
+   /** Destruction. Ends the running game. */
+   GameController::~GameController()
+   {
+      stopGame();
+      removeHostedGame();
+   }
+
+   /** Initializes a new remote game, hosted as the first game of a server of its own */
    void GameController::startServer(const std::string& serverName, uint8_t numberOfPlayers)
    {
       LOG_INFO(DOM) << "Initializing Remote Game server [" << serverName << "] with " << (int) numberOfPlayers << " players ...";
 
 #ifdef BOOST_AVAILABLE
-      // TODO Stop mThread
+      // The IO threads are started only by controllers running a server of their own
+      hostGame(std::make_shared<GameServer>(), serverName, numberOfPlayers);
+      mGameServer->startServer(serverName);
+#else
+      throw util::Exception("Server implementation not available");
+#endif
+   }
+
+   /**
+    * Initializes a new remote game, hosted on a server shared with other controllers. The server
+    * must have been started by its owner.
+    * @return the ID clients use to join the game
+    */
+   GameId GameController::hostGame(std::shared_ptr<GameServer> server, const std::string& gameName, uint8_t numberOfPlayers)
+   {
+#ifdef BOOST_AVAILABLE
+      stopGame();
+
+      removeHostedGame();
 
       mPlayers.clear();
+      mClocks.clear();
       mGame = std::make_shared<Game>(numberOfPlayers);
-      mGame->setGameServer(mGameServer);
-      mGameServer->startServer(serverName);
+      mIsRemoteGame = false;
+
+      mGameServer = server;
+      mHostedGameId = mGameServer->addGame(*this, mGame, gameName);
+      mGame->setGameServer(mGameServer, mHostedGameId);
+
+      return mHostedGameId;
 #else
+      (void) server;
+      (void) gameName;
+      (void) numberOfPlayers;
       throw util::Exception("Server implementation not available");
 #endif
    }
@@ -56,22 +108,61 @@ namespace qcore
    std::list<Endpoint> GameController::discoverRemoteGames()
    {
 #ifdef BOOST_AVAILABLE
+      if (not mGameServer)
+      {
+         mGameServer = std::make_shared<GameServer>();
+      }
+
       return mGameServer->discoverServers();
 #else
       throw util::Exception("Server implementation not available");
 #endif
    }
 
-   void GameController::connectToRemoteGame(const std::string& ip)
+   /** Lists the games hosted by a game server */
+   std::list<GameInfo> GameController::listRemoteGames(const std::string& ip)
    {
 #ifdef BOOST_AVAILABLE
-      // TODO Stop mThread
+      // Lobby connection, closed once the list is received
+      return RemoteGame(*this, 2, ip).listGames();
+#else
+      (void) ip;
+      throw util::Exception("Server implementation not available");
+#endif
+   }
+
+   /** Connects to a game hosted by a remote server */
+   void GameController::connectToRemoteGame(const std::string& ip, GameId gameId)
+   {
+#ifdef BOOST_AVAILABLE
+      stopGame();
+
+      auto remoteGame = std::make_shared<RemoteGame>(*this, 2, ip);
+      remoteGame->joinGame(gameId);
+
+      removeHostedGame();
 
       mPlayers.clear();
-      mGame = std::make_shared<RemoteGame>(*this, 2, ip);
+      mClocks.clear();
+      mGame = remoteGame;
       mIsRemoteGame = true;
 #else
       (void) ip;
+      (void) gameId;
+      throw util::Exception("Server implementation not available");
+#endif
+   }
+
+   /** Connects to a remote game as a spectator. Board updates are grouped at the interval, if not zero. */
+   void GameController::spectateRemoteGame(const std::string& ip, std::chrono::milliseconds batchInterval, GameId gameId)
+   {
+#ifdef BOOST_AVAILABLE
+      connectToRemoteGame(ip, gameId);
+      std::dynamic_pointer_cast<RemoteGame>(mGame)->spectate(batchInterval);
+#else
+      (void) ip;
+      (void) batchInterval;
+      (void) gameId;
       throw util::Exception("Server implementation not available");
 #endif
    }
@@ -81,10 +172,14 @@ namespace qcore
    {
       LOG_INFO(DOM) << "Initializing Local Game with " << (int) numberOfPlayers <<" players ...";
 
-      // TODO Stop mThread
+      stopGame();
+
+      removeHostedGame();
 
       mPlayers.clear();
+      mClocks.clear();
       mGame = std::make_shared<Game>(numberOfPlayers);
+      mIsRemoteGame = false;
    }
 
    /** Adds a new player to the game, with the plugin defining his behavior */
@@ -144,120 +239,123 @@ namespace qcore
       return playerId;
    }
 
-   /** Starts the game */
-   void GameController::start(bool oneStep)
+   /** Asks a local player of a remote game for his next move, on the executor */
+   void GameController::notifyRemoteMove(PlayerId playerId)
    {
-      if (not mGame)
-      {
-         throw util::Exception("Game not initialized");
-      }
+      PlayerPtr player = getPlayer(playerId);
+      ExecutorPtr executor;
+      size_t affinity;
 
-      if (mIsRemoteGame)
       {
-         throw util::Exception("Game must be started by the remote server");
+         std::lock_guard<std::mutex> lock(mMutex);
+         executor = mExecutor;
+         affinity = mAffinity;
+         ++mPendingMoves;
       }
 
-      if (mPlayers.size() != mGame->getNumberOfPlayers())
+      executor->post([this, player]()
       {
-         throw util::Exception("Not all players joined the game");
-      }
+         try
+         {
+            player->notifyMove();
+         }
+         catch (std::exception& e)
+         {
+            LOG_ERROR(DOM) << "Exception during player move: " << e.what();
+         }
 
-      if (mPlayerThread.joinable())
-      {
-         // TODO: Stop thread
-         mPlayerThread.join();
-      }
+         std::lock_guard<std::mutex> lock(mMutex);
+         --mPendingMoves;
+         mFinishedCv.notify_all();
+      }, affinity);
+   }
 
-      if (mWatchThread.joinable())
-      {
-         mWatchThread.join();
-      }
+   /** Sets the minimum duration of a move. Quicker moves are delayed to keep the game watchable. */
+   void GameController::setMinMoveTime(std::chrono::milliseconds minMoveTime)
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mMinMoveTime = minMoveTime;
+   }
 
-      mPlayerThread = std::thread([&, oneStep]()
+   /** Sets the time allowed to all players, except the ones with a time control of their own */
+   void GameController::setTimeControl(const TimeControl& timeControl)
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mDefaultTimeControl = timeControl;
+
+      for (auto& c : mClocks)
       {
-         while(not getBoardState()->isFinished())
+         if (mTimeControls.find(c.first) == mTimeControls.end())
          {
-            PlayerPtr currentPlayer = getCurrentPlayer();
-
-            {
-               // Mark action start
-               std::lock_guard<std::mutex> lock(mMutex);
-               mActionTs = std::chrono::steady_clock::now();
-               mMoveInProgress = true;
-            }
+            c.second = PlayerClock(timeControl);
+         }
+      }
+   }
 
-            // Notify the player to make his next move
-            try
-            {
-               currentPlayer->notifyMove();
-            }
-            catch (std::exception& e)
-            {
-               LOG_ERROR(DOM) << "Exception during player move: " << e.what();
-            }
+   /** Sets the time allowed to the specified player. Resets player's clock. */
+   void GameController::setTimeControl(PlayerId playerId, const TimeControl& timeControl)
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mTimeControls[playerId] = timeControl;
+      mClocks.erase(playerId);
+   }
 
-            // Wait for the player to decide
-            mGame->waitPlayerMove(currentPlayer->getId());
+   /** Sets the executor running player moves. Moves of this controller's games prefer the worker given by the affinity. */
+   void GameController::setExecutor(ExecutorPtr executor, size_t affinity)
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mExecutor = executor;
+      mAffinity = affinity;
+   }
 
-            {
-               // Mark action start
-               std::lock_guard<std::mutex> lock(mMutex);
-               mMoveInProgress = false;
-               auto duration = std::chrono::steady_clock::now() - mActionTs;
-               auto moveDutationMs = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+   /** Records the games started by start() to the writer once finished. Null stops recording. */
+   void GameController::setRecordWriter(GameRecordWriterPtr writer)
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mRecordWriter = writer;
+   }
 
-               LOG_INFO(DOM) << "Move duration [" << moveDutationMs / 1000.0 << " sec]";
-               currentPlayer->setLastMoveDuration(moveDutationMs);
+   /** Starts the game */
+   void GameController::start(bool oneStep)
+   {
+      if (not mGame)
+      {
+         throw util::Exception("Game not initialized");
+      }
 
-               // Wait a bit to make the game watchable (during quick moves)
-               if (duration < PLAYER_MIN_TIME_MS)
-               {
-                  std::this_thread::sleep_for(PLAYER_MIN_TIME_MS - duration);
-               }
-            }
+      if (mIsRemoteGame)
+      {
+         throw util::Exception("Game must be started by the remote server");
+      }
 
-            getBoardState()->notifyStateChange();
+      if (mPlayers.size() != mGame->getNumberOfPlayers())
+      {
+         throw util::Exception("Not all players joined the game");
+      }
 
-            if (oneStep)
-               break;
-         }
-      });
+      // TODO: Stop the previous game
+      waitFinished();
 
       // Enable watchdog
       const char *wdEnv = std::getenv("QUORIDOR_PLAYER_TIMEOUT_DISABLE");
-      bool wdDisabled = wdEnv ? std::stoi(wdEnv) : false;
 
-      if (!oneStep && !wdDisabled)
       {
-         mWatchThread = std::thread([&]()
-         {
-            while(not getBoardState()->isFinished())
-            {
-               std::unique_lock<std::mutex> lock(mMutex);
-               if (mMoveInProgress)
-               {
-                  auto timelimit = mActionTs + PLAYER_MOVE_TIMEOUT_MS;
-
-                  if (std::chrono::steady_clock::now() > timelimit)
-                  {
-                     LOG_ERROR(DOM) << "Time limit exceeded by player " << (int) mGame->getCurrentPlayer() << "! Game must end.";
-                     mGame->end();
-                     break;
-                  }
-                  else
-                  {
-                     lock.unlock();
-                     mGame->waitPlayerMoveUntil(mGame->getCurrentPlayer(), timelimit);
-                  }
-               }
-               else
-               {
-                  lock.unlock();
-                  std::this_thread::sleep_for(1ms);
-               }
-            }
-         });
+         std::lock_guard<std::mutex> lock(mMutex);
+         mRunning = true;
+         mOneStep = oneStep;
+         mTimedOutPlayer = 0xFF;
+         mWatchdogDisabled = oneStep or (wdEnv ? std::stoi(wdEnv) : false);
       }
+
+      mGame->setMoveListener([this]{ onMoveDone(); });
+      requestMove();
+   }
+
+   /** Blocks until the game started by start() has ended and all players returned from their last move */
+   void GameController::waitFinished()
+   {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mFinishedCv.wait(lock, [&]{ return not mRunning and not mPendingMoves; });
    }
 
    /** Returns the current's game state */
@@ -310,6 +408,12 @@ namespace qcore
        mGame->restore();
    }
 
+   /** Restarts the game from the end of the specified history, with the next player on move */
+   void GameController::loadGame(const BoardHistory& history)
+   {
+      mGame->load(history);
+   }
+
    bool GameController::moveCurrentPlayer(Direction direction)
    {
       auto player = getCurrentPlayer();
@@ -335,4 +439,206 @@ namespace qcore
       return player->placeWall(wall.rotate(static_cast<int>(initialState)));
    }
 
+   /** Asks the player on move for his next move, or marks the end of the game */
+   void GameController::requestMove()
+   {
+      std::unique_lock<std::mutex> lock(mMutex);
+
+      if (getBoardState()->isFinished())
+      {
+         if (mRecordWriter)
+         {
+            // Written before the end is signaled, so the record is complete once waitFinished() returns
+            auto writer = mRecordWriter;
+            PlayerId winner = getBoardState()->getWinner();
+
+            // The winner of a game lost on time isn't on the board, as for the games recorded by the tournaments
+            if (mTimedOutPlayer != 0xFF)
+            {
+               winner = mGame->getNumberOfPlayers() == 2 ? mTimedOutPlayer ^ 1 : 0xFF;
+            }
+
+            lock.unlock();
+
+            try
+            {
+               writer->append(mGame->getNumberOfPlayers(), winner, mGame->getActions());
+            }
+            catch (std::exception& e)
+            {
+               LOG_ERROR(DOM) << "Failed to record the game: " << e.what();
+            }
+
+            lock.lock();
+         }
+
+         mRunning = false;
+         mFinishedCv.notify_all();
+         return;
+      }
+
+      PlayerPtr player = getCurrentPlayer();
+      PlayerId playerId = player->getId();
+      PlayerClock& clock = getClock(playerId);
+
+      // Mark action start
+      mActionTs = std::chrono::steady_clock::now();
+      mMovingPlayer = playerId;
+      mMoveInProgress = true;
+      ++mPendingMoves;
+
+      if (not mWatchdogDisabled and clock.isLimited())
+      {
+         // Ends the game if the board didn't change until the deadline
+         mTimer = mScheduler->schedule(clock.getDeadline(mActionTs),
+            [this, game = mGame, playerId, version = getBoardState()->getSnapshot()->getVersion()]()
+         {
+            if (game->getBoardState()->getSnapshot()->getVersion() == version)
+            {
+               LOG_ERROR(DOM) << "Time limit exceeded by player " << (int) playerId << "! Game must end.";
+
+               {
+                  std::lock_guard<std::mutex> lock(mMutex);
+                  mTimedOutPlayer = playerId;
+               }
+
+               game->end();
+            }
+         });
+      }
+
+      // Read under the lock, setExecutor() may change them
+      auto executor = mExecutor;
+      size_t affinity = mAffinity;
+      lock.unlock();
+
+      // Notify the player to make his next move
+      executor->post([this, player]()
+      {
+         try
+         {
+            player->notifyMove();
+         }
+         catch (std::exception& e)
+         {
+            LOG_ERROR(DOM) << "Exception during player move: " << e.what();
+         }
+
+         // The player may still be thinking after the game ended by timeout
+         std::lock_guard<std::mutex> lock(mMutex);
+         --mPendingMoves;
+         mFinishedCv.notify_all();
+      }, affinity);
+   }
+
+   /** Called when the player on move has made his move, or when the game ended */
+   void GameController::onMoveDone()
+   {
+      std::unique_lock<std::mutex> lock(mMutex);
+
+      if (not mMoveInProgress)
+      {
+         return;
+      }
+
+      // Mark action end
+      mMoveInProgress = false;
+      mScheduler->cancel(mTimer);
+
+      auto duration = std::chrono::steady_clock::now() - mActionTs;
+      auto moveDutationMs = std::chrono::duration_cast<std::chrono::milliseconds>(duration);
+
+      LOG_INFO(DOM) << "Move duration [" << moveDutationMs.count() / 1000.0 << " sec]";
+      getPlayer(mMovingPlayer)->setLastMoveDuration(moveDutationMs.count());
+
+      if (not getClock(mMovingPlayer).stop(moveDutationMs))
+      {
+         LOG_WARN(DOM) << "Player " << (int) mMovingPlayer << " exceeded his time";
+      }
+
+      auto next = [this, oneStep = mOneStep]()
+      {
+         getBoardState()->notifyStateChange();
+
+         if (oneStep)
+         {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mRunning = false;
+            mFinishedCv.notify_all();
+         }
+         else
+         {
+            requestMove();
+         }
+      };
+
+      // The scheduler thread must not read the members while setExecutor() changes them
+      auto executor = mExecutor;
+      size_t affinity = mAffinity;
+
+      // Wait a bit to make the game watchable (during quick moves)
+      if (duration < mMinMoveTime)
+      {
+         mScheduler->schedule(mActionTs + mMinMoveTime, [executor, affinity, next]{ executor->post(next, affinity); });
+      }
+      else
+      {
+         executor->post(next, affinity);
+      }
+   }
+
+   /** Returns the clock of the specified player, started with his time control if needed */
+   PlayerClock& GameController::getClock(PlayerId playerId)
+   {
+      auto it = mClocks.find(playerId);
+
+      if (it == mClocks.end())
+      {
+         auto tc = mTimeControls.find(playerId);
+         it = mClocks.emplace(playerId, PlayerClock(tc != mTimeControls.end() ? tc->second : mDefaultTimeControl)).first;
+      }
+
+      return it->second;
+   }
+
+   /** Stops hosting the current game on the game server, and disconnects its clients */
+   void GameController::removeHostedGame()
+   {
+#ifdef BOOST_AVAILABLE
+      if (mHostedGameId != INVALID_GAME_ID)
+      {
+         mGameServer->removeGame(mHostedGameId);
+         mGame->setGameServer(nullptr, INVALID_GAME_ID);
+         mHostedGameId = INVALID_GAME_ID;
+      }
+#endif
+   }
+
+   /** Ends the local game started by start(), waits for its players and stops listening to its moves */
+   void GameController::stopGame()
+   {
+      if (not mGame or mIsRemoteGame)
+      {
+         return;
+      }
+
+      bool running;
+
+      {
+         std::lock_guard<std::mutex> lock(mMutex);
+         running = mRunning;
+      }
+
+      if (running)
+      {
+         mGame->end();
+      }
+
+      // Players may still be thinking after a game ended by timeout
+      waitFinished();
+
+      // Late moves of the old game must not reach the next one
+      mGame->setMoveListener(nullptr);
+   }
+
 } // namespace qcore
@@ -0,0 +1,226 @@
+#include "GameRecord.h"
+#include "Game.h"
+#include "Protocol.h"
+#include "QcoreUtil.h"
+
+#include <cstring>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace qcore
+{
+   /** Log domain */
+   const char * const DOM = "qcore::GR";
+
+   uint32_t GameRecordView::getNumberOfActions() const
+   {
+      return readUint32(mData + 4);
+   }
+
+   /** Returns the specified action, in absolute coordinates */
+   PlayerAction GameRecordView::getAction(uint32_t index) const
+   {
+      const uint8_t* packed = mData + GAME_RECORD_HEADER_SIZE + index * GAME_RECORD_ACTION_SIZE;
+
+      PlayerAction action;
+      action.unpack(uint16_t(packed[0] | packed[1] << 8));
+
+      return action;
+   }
+
+   /** Construction. Creates the file, or opens it for append. Throws if it isn't a record file. */
+   GameRecordWriter::GameRecordWriter(const std::string& path)
+   {
+      char magic[sizeof(GAME_RECORD_MAGIC)];
+      std::ifstream existing(path, std::ios::binary);
+      bool empty = not existing or existing.peek() == std::ifstream::traits_type::eof();
+
+      if (not empty and (not existing.read(magic, sizeof(magic)) or std::memcmp(magic, GAME_RECORD_MAGIC, sizeof(magic))))
+      {
+         throw util::Exception("Not a game record file: " + path);
+      }
+
+      existing.close();
+      mFile.open(path, std::ios::binary | std::ios::app);
+
+      if (not mFile)
+      {
+         throw util::Exception("Failed to open game record file: " + path);
+      }
+
+      if (empty)
+      {
+         mFile.write(GAME_RECORD_MAGIC, sizeof(GAME_RECORD_MAGIC));
+         mFile.flush();
+      }
+
+      LOG_INFO(DOM) << "Recording games to [" << path << "]";
+   }
+
+   /** Appends a game, with the actions applied until now */
+   void GameRecordWriter::append(const Game& game)
+   {
+      append(game.getNumberOfPlayers(), game.getBoardState()->getSnapshot()->getWinner(), game.getActions());
+   }
+
+   /** Appends a game */
+   void GameRecordWriter::append(uint8_t numberOfPlayers, PlayerId winner, const std::vector<PlayerAction>& actions)
+   {
+      std::vector<uint8_t> record(GAME_RECORD_HEADER_SIZE + actions.size() * GAME_RECORD_ACTION_SIZE);
+      uint8_t* data = record.data();
+
+      data[0] = numberOfPlayers;
+      data[1] = winner;
+      data[2] = 0;
+      data[3] = 0;
+      writeUint32(data + 4, (uint32_t) actions.size());
+      data += GAME_RECORD_HEADER_SIZE;
+
+      for (auto& a : actions)
+      {
+         uint16_t packed = a.pack();
+         data[0] = uint8_t(packed);
+         data[1] = uint8_t(packed >> 8);
+         data += GAME_RECORD_ACTION_SIZE;
+      }
+
+      std::lock_guard<std::mutex> lock(mMutex);
+
+      mFile.write(reinterpret_cast<const char*>(record.data()), record.size());
+      mFile.flush();
+
+      if (not mFile)
+      {
+         throw util::Exception("Failed to write game record");
+      }
+   }
+
+   /** Construction, at the specified position in the file data */
+   GameRecordReader::Iterator::Iterator(const uint8_t* position, const uint8_t* end) :
+      mPosition(position),
+      mEnd(end)
+   {
+      load();
+   }
+
+   GameRecordReader::Iterator& GameRecordReader::Iterator::operator++()
+   {
+      mPosition += mGame.getSize();
+      load();
+
+      return *this;
+   }
+
+   /** Checks the game at the current position */
+   void GameRecordReader::Iterator::load()
+   {
+      if (mPosition == mEnd)
+      {
+         return;
+      }
+
+      mGame = GameRecordView(mPosition);
+
+      // The header is checked first, the size of the game is read from it
+      if (size_t(mEnd - mPosition) < GAME_RECORD_HEADER_SIZE or size_t(mEnd - mPosition) < mGame.getSize())
+      {
+         throw util::Exception("Truncated game record");
+      }
+   }
+
+   /** Construction. Maps the file in memory. Throws if it isn't a record file. */
+   GameRecordReader::GameRecordReader(const std::string& path) :
+      mData(nullptr),
+      mSize(0)
+   {
+#ifdef WIN32
+      HANDLE file = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+      if (file == INVALID_HANDLE_VALUE)
+      {
+         throw util::Exception("Failed to open game record file: " + path);
+      }
+
+      LARGE_INTEGER size;
+      HANDLE mapping = GetFileSizeEx(file, &size) ? CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+
+      if (mapping)
+      {
+         mSize = (size_t) size.QuadPart;
+         mData = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+         CloseHandle(mapping);
+      }
+
+      CloseHandle(file);
+#else
+      int fd = open(path.c_str(), O_RDONLY);
+
+      if (fd < 0)
+      {
+         throw util::Exception("Failed to open game record file: " + path);
+      }
+
+      struct stat st;
+
+      if (fstat(fd, &st) == 0 and st.st_size > 0)
+      {
+         void* data = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+         if (data != MAP_FAILED)
+         {
+            mSize = (size_t) st.st_size;
+            mData = static_cast<const uint8_t*>(data);
+
+            // Games are mostly read from the beginning to the end
+            madvise(data, mSize, MADV_SEQUENTIAL);
+         }
+      }
+
+      close(fd);
+#endif
+
+      if (not mData or mSize < sizeof(GAME_RECORD_MAGIC) or std::memcmp(mData, GAME_RECORD_MAGIC, sizeof(GAME_RECORD_MAGIC)))
+      {
+         unmap();
+         throw util::Exception("Not a game record file: " + path);
+      }
+   }
+
+   /** Destruction. Unmaps the file. */
+   GameRecordReader::~GameRecordReader()
+   {
+      unmap();
+   }
+
+   GameRecordReader::Iterator GameRecordReader::begin() const
+   {
+      return Iterator(mData + sizeof(GAME_RECORD_MAGIC), mData + mSize);
+   }
+
+   GameRecordReader::Iterator GameRecordReader::end() const
+   {
+      return Iterator(mData + mSize, mData + mSize);
+   }
+
+   /** Releases the memory mapping */
+   void GameRecordReader::unmap()
+   {
+      if (mData)
+      {
+#ifdef WIN32
+         UnmapViewOfFile(mData);
+#else
+         munmap(const_cast<uint8_t*>(mData), mSize);
+#endif
+         mData = nullptr;
+      }
+   }
+
+} // namespace qcore
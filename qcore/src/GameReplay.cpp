@@ -0,0 +1,87 @@
+#include "GameReplay.h"
+#include "GameRecord.h"
+#include "Game.h"
+#include "QcoreUtil.h"
+
+#include <algorithm>
+
+namespace qcore
+{
+   /** Construction, from the actions of a game in absolute coordinates */
+   GameReplay::GameReplay(uint8_t numberOfPlayers, std::vector<PlayerAction> actions, size_t checkpointInterval) :
+      mNumberOfPlayers(numberOfPlayers),
+      mActions(std::move(actions)),
+      mCheckpointInterval(checkpointInterval ? checkpointInterval : 1),
+      mBoard(std::make_shared<BoardSnapshot>(numberOfPlayers)),
+      mPosition(0)
+   {
+      mCheckpoints.push_back(mBoard);
+   }
+
+   /** Construction, from the actions applied on a game until now */
+   GameReplay::GameReplay(const Game& game, size_t checkpointInterval) :
+      GameReplay(game.getNumberOfPlayers(), game.getActions(), checkpointInterval)
+   {
+   }
+
+   /** Construction, from a game of a record file */
+   GameReplay::GameReplay(const GameRecordView& game, size_t checkpointInterval) :
+      GameReplay(game.getNumberOfPlayers(), {}, checkpointInterval)
+   {
+      mActions.reserve(game.getNumberOfActions());
+
+      for (uint32_t i = 0; i < game.getNumberOfActions(); ++i)
+      {
+         mActions.push_back(game.getAction(i));
+      }
+   }
+
+   /** Applies the next action. Returns false at the end of the game. */
+   bool GameReplay::next()
+   {
+      if (mPosition == mActions.size())
+      {
+         return false;
+      }
+
+      // Snapshots returned to the caller and checkpoints are never modified
+      if (mBoard.use_count() > 1)
+      {
+         mBoard = std::make_shared<BoardSnapshot>(*mBoard);
+      }
+
+      mBoard->replayAction(mActions[mPosition]);
+      ++mPosition;
+
+      if (mPosition == mCheckpoints.size() * mCheckpointInterval)
+      {
+         mCheckpoints.push_back(mBoard);
+      }
+
+      return true;
+   }
+
+   /** Moves to the board after the specified number of actions. Throws if past the end of the game. */
+   void GameReplay::seek(size_t position)
+   {
+      if (position > mActions.size())
+      {
+         throw util::Exception("Replay position " + std::to_string(position) + " is past the end of the game");
+      }
+
+      // Start from the closest checkpoint, unless the current position is closer
+      size_t checkpoint = std::min(position / mCheckpointInterval, mCheckpoints.size() - 1);
+
+      if (position < mPosition or mPosition < checkpoint * mCheckpointInterval)
+      {
+         mBoard = std::const_pointer_cast<BoardSnapshot>(mCheckpoints[checkpoint]);
+         mPosition = checkpoint * mCheckpointInterval;
+      }
+
+      while (mPosition < position)
+      {
+         next();
+      }
+   }
+
+} // namespace qcore
@@ -6,8 +6,13 @@
 
 // Linux only TODO the same for windows
 #include <ifaddrs.h>
+#include <pthread.h>
+#include <time.h>
 
 #include <functional>
+#include <algorithm>
+#include <cstdlib>
+#include <array>
 
 using namespace std::literals::chrono_literals;
 using namespace boost::asio;
@@ -20,7 +25,16 @@ namespace qcore
    /** Construction */
    RemoteSession::RemoteSession(GameServer& server, boost::asio::io_service& ioService) :
       mServer(server),
-      mSocket(ioService)
+      mStrand(ioService),
+      mSocket(ioService),
+      mIdentified(false),
+      mGameId(INVALID_GAME_ID),
+      mOutboundBytes(0),
+      mWriteActive(false),
+      mClosed(false),
+      mBatchInterval(0),
+      mBatchTimer(ioService),
+      mBatchPending(false)
    {
    }
 
@@ -36,16 +50,195 @@ namespace qcore
       std::string ip = mSocket.remote_endpoint().address().to_string();
       LOG_INFO(DOM) << "Client Session [x] connected from [" << ip << "]";
 
-      mSocket.async_read_some(
-         buffer(mRecvData),
-         boost::bind(&RemoteSession::handleRead, shared_from_this(), placeholders::error, placeholders::bytes_transferred));
+      mStrand.post(boost::bind(&RemoteSession::startRead, shared_from_this()));
+   }
+
+   /**
+    * Queues a message for the client. Doesn't block. Batchable frames may be held back until
+    * the next batch interval.
+    */
+   void RemoteSession::send(uint8_t messageType, const uint8_t* data, size_t size)
+   {
+      LOG_DEBUG(DOM) << "Client Session [x]: Sending message type [" << (int) messageType << "] size [" << size << "]";
+      send(encodeFrame(messageType, data, size));
+   }
+
+   /**
+    * Queues a message for the client. Doesn't block. Batchable frames may be held back until
+    * the next batch interval.
+    */
+   void RemoteSession::send(const FrameBuffer& frame, bool batch)
+   {
+      {
+         std::lock_guard<std::mutex> lock(mSendMutex);
+
+         if (mClosed)
+         {
+            return;
+         }
+
+         if (mOutboundBytes + frame->size() <= MAX_SESSION_BACKLOG)
+         {
+            mOutbound.push_back(frame);
+            mOutboundBytes += frame->size();
+
+            if (batch and mBatchInterval.count())
+            {
+               // Batched frames wait for the timer, or for any write in progress
+               if (not mWriteActive and not mBatchPending)
+               {
+                  mBatchPending = true;
+                  mStrand.post(boost::bind(&RemoteSession::startBatchTimer, shared_from_this()));
+               }
+            }
+            else if (not mWriteActive)
+            {
+               mWriteActive = true;
+               mStrand.post(boost::bind(&RemoteSession::startWrite, shared_from_this()));
+            }
+
+            return;
+         }
+      }
+
+      close("Client too slow, " + std::to_string(MAX_SESSION_BACKLOG) + " bytes not sent");
+   }
+
+   /** Closes the connection from any thread. Queued messages are dropped. */
+   void RemoteSession::close(const std::string& reason)
+   {
+      {
+         std::lock_guard<std::mutex> lock(mSendMutex);
+
+         if (mClosed)
+         {
+            return;
+         }
+
+         mClosed = true;
+         mOutbound.clear();
+         mOutboundBytes = 0;
+      }
+
+      LOG_WARN(DOM) << "Client Session [x]: Closing connection. " << reason;
+
+      auto self = shared_from_this();
+
+      mStrand.post([self]
+      {
+         boost::system::error_code ignored;
+         self->mSocket.close(ignored);
+         self->mServer.removeClient(self);
+      });
+   }
+
+   /** Writes all queued frames at once. Runs on the session's strand. */
+   void RemoteSession::startWrite()
+   {
+      std::vector<const_buffer> buffers;
+
+      {
+         std::lock_guard<std::mutex> lock(mSendMutex);
+
+         if (mClosed or mOutbound.empty())
+         {
+            mWriteActive = false;
+            return;
+         }
+
+         // Frames queued while the previous write was running are coalesced in one write
+         mWriting.assign(mOutbound.begin(), mOutbound.end());
+         mOutbound.clear();
+         mOutboundBytes = 0;
+      }
+
+      buffers.reserve(mWriting.size());
+
+      for (auto& f : mWriting)
+      {
+         buffers.push_back(buffer(*f));
+      }
+
+      boost::asio::async_write(
+         mSocket,
+         buffers,
+         mStrand.wrap(boost::bind(&RemoteSession::handleWrite, shared_from_this(), placeholders::error)));
+   }
+
+   /** Handles the end of a write */
+   void RemoteSession::handleWrite(const boost::system::error_code& error)
+   {
+      mWriting.clear();
+
+      if (error)
+      {
+         close("Write failed: " + error.message());
+         return;
+      }
+
+      startWrite();
+   }
+
+   /** Waits for the end of the batch interval. Runs on the session's strand. */
+   void RemoteSession::startBatchTimer()
+   {
+      std::chrono::milliseconds interval;
+
+      {
+         std::lock_guard<std::mutex> lock(mSendMutex);
+         interval = mBatchInterval;
+      }
+
+      mBatchTimer.expires_after(interval);
+      mBatchTimer.async_wait(mStrand.wrap(boost::bind(&RemoteSession::handleBatchTimer, shared_from_this(), placeholders::error)));
+   }
+
+   /** Writes the frames batched during the interval */
+   void RemoteSession::handleBatchTimer(const boost::system::error_code&)
+   {
+      {
+         std::lock_guard<std::mutex> lock(mSendMutex);
+         mBatchPending = false;
+
+         if (mWriteActive or mClosed)
+         {
+            return;
+         }
+
+         mWriteActive = true;
+      }
+
+      startWrite();
+   }
+
+   /** Sets the interval at which batchable frames are written. Zero writes them immediately. */
+   void RemoteSession::setBatchInterval(std::chrono::milliseconds interval)
+   {
+      std::lock_guard<std::mutex> lock(mSendMutex);
+      mBatchInterval = interval;
+   }
+
+   /** Sends the response to a client request. The status is 0 on success. */
+   void RemoteSession::respond(RequestId requestId, uint8_t status, const std::string& data)
+   {
+      LOG_DEBUG(DOM) << "Client Session [x]: Sending response to request [" << requestId << "] status [" << (int) status << "]";
+
+      std::vector<uint8_t> payload(RESPONSE_HEADER_SIZE + data.size());
+      writeUint32(payload.data(), requestId);
+      payload[sizeof(RequestId)] = status;
+      std::copy(data.begin(), data.end(), payload.begin() + RESPONSE_HEADER_SIZE);
+
+      send(GameServer::ServerResponse, payload.data(), payload.size());
    }
 
-   /** Sends a message to the client */
-   void RemoteSession::send(const std::string& message)
+   /** Receives the next bytes directly into the frame reader */
+   void RemoteSession::startRead()
    {
-      LOG_DEBUG(DOM) << "Client Session [x]: Sending message type [" << (int) message.at(0) << "] size [" << message.size() << "]";
-      boost::asio::write(mSocket, buffer(char(message.size()) + message));
+      auto space = mReader.prepare();
+
+      mSocket.async_read_some(
+         buffer(space.first, space.second),
+         mStrand.wrap(boost::bind(&RemoteSession::handleRead, shared_from_this(), placeholders::error, placeholders::bytes_transferred)));
    }
 
    /** Handler socket read */
@@ -53,70 +246,167 @@ namespace qcore
    {
       if (not error)
       {
-         mRecvBuffer += std::string(mRecvData.c_array(), bytesTransferred);
+         mReader.commit(bytesTransferred);
 
-         while ((uint8_t) mRecvBuffer[0] >= mRecvBuffer.size() - 1)
+         try
          {
-            processMessage(mRecvBuffer.substr(1, mRecvBuffer[0]));
-            mRecvBuffer.erase(0, mRecvBuffer[0] + 1);
-         }
+            FrameView frame;
 
-         // TODO: Detect invalid message and clear buffer
+            while (mReader.next(frame))
+            {
+               processMessage(frame);
+            }
+         }
+         catch (std::exception& e)
+         {
+            close(std::string("Invalid message. ") + e.what());
+            return;
+         }
 
-         mSocket.async_read_some(
-            buffer(mRecvData),
-            boost::bind(&RemoteSession::handleRead, shared_from_this(), placeholders::error, placeholders::bytes_transferred));
+         startRead();
       }
       else
       {
-         LOG_WARN(DOM) << "Client Session [x] disconnected: " << error.message();
-         mServer.removeClient(shared_from_this());
+         close("Client disconnected: " + error.message());
       }
    }
 
-   /** Processes a received message */
-   void RemoteSession::processMessage(const std::string& message)
+   /** Processes a received message. Throws if the message doesn't carry a request ID. */
+   void RemoteSession::processMessage(const FrameView& frame)
    {
+      LOG_DEBUG(DOM) << "Client Session [x]: Received message type [" << (int) frame.messageType << "] size [" << frame.size << "]";
+
+      if (frame.size < REQUEST_HEADER_SIZE)
+      {
+         throw util::Exception("Missing request ID");
+      }
+
+      RequestId requestId = readUint32(frame.data);
+      const uint8_t* data = frame.data + REQUEST_HEADER_SIZE;
+      size_t size = frame.size - REQUEST_HEADER_SIZE;
+
       try
       {
-         char messageType = message.at(0);
-         LOG_DEBUG(DOM) << "Client Session [x]: Received message type [" << (int) messageType << "] size [" << message.size() << "]";
+         if (not mIdentified and frame.messageType != GameServer::Identification)
+         {
+            throw util::Exception("Client not identified");
+         }
 
-         switch (messageType)
+         switch (frame.messageType)
          {
             case GameServer::Identification:
             {
-               if (message.substr(1) != CLIENT_ID)
+               std::string clientId(reinterpret_cast<const char*>(data), size);
+
+               if (clientId.empty() or (uint8_t) clientId.at(0) != PROTOCOL_VERSION)
+               {
+                  throw util::Exception("Unsupported protocol version");
+               }
+
+               if (clientId.substr(1) != CLIENT_ID)
                {
                   throw util::Exception("Client identification failed");
                }
 
-               send(std::string { GameServer::ServerResponse, 0 } + SERVER_ID);
+               mIdentified = true;
+               respond(requestId, 0, std::string { (char) PROTOCOL_VERSION } + SERVER_ID);
+               break;
+            }
+
+            case GameServer::ListGames:
+            {
+               // Count, then for each game: ID, number of players, name length and name
+               std::string games(sizeof(uint32_t), 0);
+               auto list = mServer.listGames();
+               writeUint32(reinterpret_cast<uint8_t*>(&games[0]), (uint32_t) list.size());
+
+               for (auto& g : list)
+               {
+                  std::string name = g.name.substr(0, UINT8_MAX);
+                  uint8_t id[sizeof(GameId)];
+                  writeUint32(id, g.id);
+
+                  games.append(reinterpret_cast<const char*>(id), sizeof(id));
+                  games.push_back((char) g.numberOfPlayers);
+                  games.push_back((char) name.size());
+                  games.append(name);
+               }
+
+               respond(requestId, 0, games);
+               break;
+            }
+
+            case GameServer::JoinGame:
+            {
+               if (size != sizeof(GameId))
+               {
+                  throw util::Exception("Invalid message format");
+               }
+
+               if (mGameId != INVALID_GAME_ID)
+               {
+                  throw util::Exception("Game already joined");
+               }
+
+               GameId gameId = readUint32(data);
+               mServer.joinGame(shared_from_this(), gameId);
+               mGameId = gameId;
+
+               LOG_INFO(DOM) << "Client Session [x]: Joined game [" << gameId << "]";
+               respond(requestId, 0);
                break;
             }
 
             case GameServer::AddRemotePlayer:
             {
-               auto playerName = message.substr(1);
+               std::string playerName(reinterpret_cast<const char*>(data), size);
 
                if (playerName.empty())
                {
                   throw util::Exception("Incomplete request");
                }
 
-               PlayerId id = mServer.getGameController().addRemotePlayer(shared_from_this(), playerName);
-               send({ GameServer::ServerResponse, 0, (char) id });
+               PlayerId id = mServer.addRemotePlayer(shared_from_this(), playerName);
+               respond(requestId, 0, std::string { (char) id });
                break;
             }
 
             case GameServer::PlayerAction:
+            case GameServer::ValidateAction:
             {
+               if (size != PlayerAction::ENCODED_SIZE)
+               {
+                  throw util::Exception("Invalid message format");
+               }
+
                std::string error;
                PlayerAction action;
-               action.deserialize(message.substr(1));
+               action.decode(data);
 
-               bool result = mServer.getGameController().getGame()->processPlayerAction(action, error);
-               send(std::string { GameServer::ServerResponse, (char) not result } + error);
+               auto game = mServer.getGame(mGameId);
+               bool result = frame.messageType == GameServer::PlayerAction ?
+                  game->processPlayerAction(action, error) : game->isActionValid(action, error);
+
+               respond(requestId, not result, error);
+               break;
+            }
+
+            case GameServer::JoinSpectator:
+            {
+               if (size != 0 and size != sizeof(uint16_t))
+               {
+                  throw util::Exception("Invalid message format");
+               }
+
+               uint16_t batchMs = size ? uint16_t(data[0] | data[1] << 8) : 0;
+
+               if (batchMs > MAX_SPECTATOR_BATCH_MS)
+               {
+                  throw util::Exception("Batch interval too long");
+               }
+
+               LOG_INFO(DOM) << "Client Session [x]: Spectator joined, batch interval [" << batchMs << " ms]";
+               mServer.addSpectator(shared_from_this(), requestId, std::chrono::milliseconds(batchMs));
                break;
             }
 
@@ -128,20 +418,44 @@ namespace qcore
       catch (std::exception& e)
       {
          LOG_ERROR(DOM) << "Client Session [x]: Request failed. " << e.what();
-         send(std::string({ GameServer::ServerResponse, 1}) + e.what());
+         respond(requestId, 1, e.what());
       }
    }
 
-   /** Construction */
-   GameServer::GameServer(GameController& controller) :
-      mGameController(controller),
+   /**
+    * Construction. Starts the IO threads, by default as many as set by QUORIDOR_IO_THREADS, or
+    * one for each hardware thread.
+    */
+   GameServer::GameServer(size_t ioThreads) :
       mIoServiceWork(mIoService),
-      mIoServiceThread([&]{ mIoService.run(); }),
       mDiscoverySocket(mIoService),
       mBroadcastSocket(mIoService),
-      mAcceptor(mIoService)
+      mAcceptor(mIoService),
+      mNextGameId(0)
+   {
+      if (ioThreads == 0)
+      {
+         const char *env = std::getenv("QUORIDOR_IO_THREADS");
+         ioThreads = std::max<size_t>(1, env ? std::stoul(env) : std::thread::hardware_concurrency());
+      }
+
+      for (size_t i = 0; i < ioThreads; ++i)
+      {
+         mIoThreads.emplace_back([this]{ mIoService.run(); });
+      }
+
+      LOG_DEBUG(DOM) << "IO service started with " << ioThreads << " threads";
+   }
+
+   /** Destruction. Stops the IO service and joins the IO threads. */
+   GameServer::~GameServer()
    {
-      LOG_DEBUG(DOM) << "IO service started";
+      mIoService.stop();
+
+      for (auto& t : mIoThreads)
+      {
+         t.join();
+      }
    }
 
    void GameServer::startServer(const std::string& serverName)
@@ -165,15 +479,167 @@ namespace qcore
 
    void GameServer::removeClient(RemoteSessionPtr session)
    {
+      {
+         std::lock_guard<std::mutex> lock(mGamesMutex);
+         auto it = mGames.find(session->getGameId());
+
+         if (it != mGames.end())
+         {
+            it->second.clients.remove(session);
+         }
+      }
+
+      std::lock_guard<std::mutex> lock(mClientsMutex);
       mClients.remove(session);
    }
 
-   void GameServer::send(const std::string& message)
+   /**
+    * Hosts a game. The controller must remove the game before it's destroyed.
+    * @return the ID clients use to join the game
+    */
+   GameId GameServer::addGame(GameController& controller, GamePtr game, const std::string& gameName)
+   {
+      std::lock_guard<std::mutex> lock(mGamesMutex);
+      GameId gameId = mNextGameId++;
+
+      mGames[gameId] = HostedGame { &controller, game, gameName, {} };
+      LOG_INFO(DOM) << "Hosting game [" << gameId << "] [" << gameName << "]";
+
+      return gameId;
+   }
+
+   /** Stops hosting a game and disconnects its clients */
+   void GameServer::removeGame(GameId gameId)
+   {
+      std::list<RemoteSessionPtr> clients;
+
+      {
+         std::lock_guard<std::mutex> lock(mGamesMutex);
+         auto it = mGames.find(gameId);
+
+         if (it == mGames.end())
+         {
+            return;
+         }
+
+         clients.swap(it->second.clients);
+         mGames.erase(it);
+      }
+
+      LOG_INFO(DOM) << "Game [" << gameId << "] removed";
+
+      for (auto& c : clients)
+      {
+         c->close("Game closed");
+      }
+   }
+
+   /** Returns the games currently hosted */
+   std::list<GameInfo> GameServer::listGames()
+   {
+      std::list<GameInfo> games;
+      std::lock_guard<std::mutex> lock(mGamesMutex);
+
+      for (auto& g : mGames)
+      {
+         games.push_back({ g.first, g.second.name, g.second.game->getNumberOfPlayers() });
+      }
+
+      return games;
+   }
+
+   /** Adds a client to the game, which then receives its updates. Throws if the game isn't hosted. */
+   void GameServer::joinGame(RemoteSessionPtr session, GameId gameId)
+   {
+      std::lock_guard<std::mutex> lock(mGamesMutex);
+      findGame(gameId).clients.push_back(session);
+   }
+
+   /** Returns a hosted game. Throws if the game isn't hosted. */
+   GamePtr GameServer::getGame(GameId gameId)
+   {
+      std::lock_guard<std::mutex> lock(mGamesMutex);
+      return findGame(gameId).game;
+   }
+
+   /** Adds a player of the client to the game joined by the client */
+   PlayerId GameServer::addRemotePlayer(RemoteSessionPtr session, const std::string& playerName)
+   {
+      // Locked during the call, so the controller can't remove the game and go away meanwhile
+      std::lock_guard<std::mutex> lock(mGamesMutex);
+      return findGame(session->getGameId()).controller->addRemotePlayer(session, playerName);
+   }
+
+   /**
+    * Answers a spectator's join request with a snapshot of the board. All later updates follow
+    * the snapshot; the ones it already contains are recognized by their version.
+    */
+   void GameServer::addSpectator(RemoteSessionPtr session, RequestId requestId, std::chrono::milliseconds batchInterval)
+   {
+      std::vector<uint8_t> snapshot;
+      std::lock_guard<std::mutex> lock(mBroadcastMutex);
+
+      getGame(session->getGameId())->getBoardState()->getSnapshot()->encode(snapshot);
+      session->setBatchInterval(batchInterval);
+      session->respond(requestId, 0, std::string(snapshot.begin(), snapshot.end()));
+   }
+
+   /** Queues a message for all clients of a game. The frame is encoded once and shared by the clients. */
+   void GameServer::send(GameId gameId, uint8_t messageType, const uint8_t* data, size_t size)
    {
-      for (auto& c : mClients)
+      FrameBuffer frame = encodeFrame(messageType, data, size);
+      std::list<RemoteSessionPtr> clients;
+      std::lock_guard<std::mutex> lock(mBroadcastMutex);
+
+      {
+         // Sessions may close themselves while sending
+         std::lock_guard<std::mutex> gamesLock(mGamesMutex);
+         auto it = mGames.find(gameId);
+
+         if (it == mGames.end())
+         {
+            return;
+         }
+
+         clients = it->second.clients;
+      }
+
+      for (auto& c : clients)
+      {
+         c->send(frame, true);
+      }
+   }
+
+   /** Returns a hosted game. Throws if the game isn't hosted. The games must be locked. */
+   GameServer::HostedGame& GameServer::findGame(GameId gameId)
+   {
+      auto it = mGames.find(gameId);
+
+      if (it == mGames.end())
       {
-         c->send(message);
+         throw util::Exception(gameId == INVALID_GAME_ID ? "No game joined" : "Unknown game " + std::to_string(gameId));
       }
+
+      return it->second;
+   }
+
+   /** Returns the CPU time used so far by the IO threads */
+   std::chrono::nanoseconds GameServer::getIoCpuTime()
+   {
+      std::chrono::nanoseconds cpuTime(0);
+
+      for (auto& t : mIoThreads)
+      {
+         clockid_t clock;
+         timespec ts;
+
+         if (pthread_getcpuclockid(t.native_handle(), &clock) == 0 and clock_gettime(clock, &ts) == 0)
+         {
+            cpuTime += std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+         }
+      }
+
+      return cpuTime;
    }
 
    void GameServer::broadcastDiscoverMessage()
@@ -294,7 +760,11 @@ namespace qcore
    {
       if (not error)
       {
-         mClients.push_back(session);
+         {
+            std::lock_guard<std::mutex> lock(mClientsMutex);
+            mClients.push_back(session);
+         }
+
          session->start();
       }
       else
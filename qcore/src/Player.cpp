@@ -16,7 +16,9 @@ namespace qcore
    Player::Player(PlayerId id, const std::string& name, GamePtr game) :
       mId(id),
       mName(name),
-      mGame(game)
+      mGame(game),
+      mLastMoveDurationMs(0),
+      mIllegalMoves(0)
    {
       LOG_INFO(DOM) << "Player " << name << " joined the game. Player ID " << (int) id;
    }
@@ -33,7 +35,13 @@ namespace qcore
    /** Returns the GameState object */
    BoardStatePtr Player::getBoardState() const
    {
-      return std::make_shared<BoardState>(*mGame->getBoardState());
+      return std::make_shared<BoardState>(getSnapshot());
+   }
+
+   /** Returns the current snapshot of the board */
+   BoardSnapshotPtr Player::getSnapshot() const
+   {
+      return mGame->getBoardState()->getSnapshot();
    }
 
    /** Returns player's position on the board */
@@ -45,7 +53,25 @@ namespace qcore
    /** Returns number of walls left for the current player */
    uint8_t Player::getWallsLeft() const
    {
-      return mGame->getBoardState()->getPlayers(mId).at(mId).wallsLeft;
+      return mGame->getBoardState()->getWallsLeft(mId);
+   }
+
+   /** Returns the number of steps the current player needs to reach the goal, ignoring other pawns */
+   uint8_t Player::getGoalDistance() const
+   {
+      return mGame->getBoardState()->getGoalDistance(mId);
+   }
+
+   /** Returns the number of steps the specified player needs to reach its goal, ignoring other pawns */
+   uint8_t Player::getGoalDistance(PlayerId playerId) const
+   {
+      return mGame->getBoardState()->getGoalDistance(playerId);
+   }
+
+   /** Returns the number of steps from the specified position to the goal of the specified player */
+   uint8_t Player::getGoalDistance(PlayerId playerId, const Position& position) const
+   {
+      return mGame->getBoardState()->getGoalDistance(playerId, position, mId);
    }
 
    /**
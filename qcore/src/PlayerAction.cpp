@@ -192,33 +192,99 @@ namespace qcore
       return { playerId, actionType, wallState.rotate(rotations), playerPosition.rotate(rotations) };
    }
 
+   /** Writes the fixed-layout binary record (ENCODED_SIZE bytes) */
+   void PlayerAction::encode(uint8_t* record) const
+   {
+      record[0] = playerId;
+      record[1] = (uint8_t) actionType;
+      record[2] = (uint8_t) playerPosition.x;
+      record[3] = (uint8_t) playerPosition.y;
+      record[4] = (uint8_t) wallState.position.x;
+      record[5] = (uint8_t) wallState.position.y;
+      record[6] = (uint8_t) wallState.orientation;
+   }
+
+   /** Reads the fixed-layout binary record (ENCODED_SIZE bytes) */
+   void PlayerAction::decode(const uint8_t* record)
+   {
+      if (record[1] > (uint8_t) ActionType::Wall or record[6] > (uint8_t) Orientation::Horizontal)
+      {
+         throw util::Exception("PlayerAction decode failed");
+      }
+
+      playerId = record[0];
+      actionType = (ActionType) record[1];
+      playerPosition.x = (int8_t) record[2];
+      playerPosition.y = (int8_t) record[3];
+      wallState.position.x = (int8_t) record[4];
+      wallState.position.y = (int8_t) record[5];
+      wallState.orientation = (Orientation) record[6];
+   }
+
+   /**
+    * Packs the action in 16 bits: y (bits 0-3), x (4-7), orientation (8), player (9-10) and
+    * action type (11-12). Only the position of a move, or the wall of a wall action, is kept.
+    */
+   uint16_t PlayerAction::pack() const
+   {
+      const Position& p = actionType == ActionType::Wall ? wallState.position : playerPosition;
+
+      if (p.x < 0 or p.x > 15 or p.y < 0 or p.y > 15 or playerId > 3)
+      {
+         throw util::Exception("PlayerAction pack failed");
+      }
+
+      uint16_t packed = uint16_t(p.y | p.x << 4 | playerId << 9 | (uint8_t) actionType << 11);
+
+      if (actionType == ActionType::Wall and wallState.orientation == Orientation::Horizontal)
+      {
+         packed |= 1 << 8;
+      }
+
+      return packed;
+   }
+
+   /** Unpacks an action packed by pack() */
+   void PlayerAction::unpack(uint16_t packed)
+   {
+      if ((packed >> 11) > (uint8_t) ActionType::Wall)
+      {
+         throw util::Exception("PlayerAction unpack failed");
+      }
+
+      Position p(int8_t((packed >> 4) & 0xF), int8_t(packed & 0xF));
+
+      playerId = (packed >> 9) & 0x3;
+      actionType = (ActionType) (packed >> 11);
+      playerPosition = Position();
+      wallState = WallState();
+
+      if (actionType == ActionType::Wall)
+      {
+         wallState.position = p;
+         wallState.orientation = packed & (1 << 8) ? Orientation::Horizontal : Orientation::Vertical;
+      }
+      else
+      {
+         playerPosition = p;
+      }
+   }
+
    std::string PlayerAction::serialize() const
    {
-      return std::string {
-         (char) playerId,
-         (char) actionType,
-         (char) playerPosition.x,
-         (char) playerPosition.y,
-         (char) wallState.position.x,
-         (char) wallState.position.y,
-         (char) wallState.orientation };
+      uint8_t record[ENCODED_SIZE];
+      encode(record);
+
+      return std::string(reinterpret_cast<const char*>(record), ENCODED_SIZE);
    }
 
    void PlayerAction::deserialize(const std::string& s)
    {
-      if (s.size() != 7)
+      if (s.size() != ENCODED_SIZE)
       {
          throw util::Exception("PlayerAction deserialize failed");
       }
 
-      // TODO Validate fields
-
-      playerId = s.at(0);
-      actionType = (ActionType) s.at(1);
-      playerPosition.x = s.at(2);
-      playerPosition.y = s.at(3);
-      wallState.position.x = s.at(4);
-      wallState.position.y = s.at(5);
-      wallState.orientation = (Orientation) s.at(6);
+      decode(reinterpret_cast<const uint8_t*>(s.data()));
    }
 } // namespace qcore
@@ -28,10 +28,12 @@ namespace qcore
 #endif
 
    std::map<std::string, PluginManager::ConstructPlayerFun> PluginManager::RegisteredPlugins;
+   std::mutex PluginManager::RegistryMutex;
 
    /** Returns the list of registered plugin names */
    std::list<std::string> PluginManager::GetPluginList()
    {
+      std::lock_guard<std::mutex> lock(RegistryMutex);
       std::list<std::string> plugins;
 
       for (auto& p : RegisteredPlugins)
@@ -44,20 +46,29 @@ namespace qcore
 
    bool PluginManager::PluginAvailable(const std::string& plugin)
    {
+      std::lock_guard<std::mutex> lock(RegistryMutex);
       return RegisteredPlugins.find(plugin) != RegisteredPlugins.end();
    }
 
    /** Player Factory method */
    PlayerPtr PluginManager::CreatePlayer(const std::string& plugin, PlayerId id, const std::string& playerName, GamePtr game)
    {
-      auto it = RegisteredPlugins.find(plugin);
+      ConstructPlayerFun construct;
 
-      if (it == RegisteredPlugins.end())
       {
-         throw util::Exception("Invalid plugin name: " + plugin);
+         std::lock_guard<std::mutex> lock(RegistryMutex);
+         auto it = RegisteredPlugins.find(plugin);
+
+         if (it == RegisteredPlugins.end())
+         {
+            throw util::Exception("Invalid plugin name: " + plugin);
+         }
+
+         construct = it->second;
       }
 
-      return it->second(id, playerName, game);
+      // Players are constructed outside the lock, a plugin may query the registry
+      return construct(id, playerName, game);
    }
 
    /** Loads libraries and registers all players found */
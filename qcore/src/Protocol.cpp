@@ -0,0 +1,167 @@
+#include "Protocol.h"
+#include "QcoreUtil.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace qcore
+{
+   /** Writes the header of a frame (FRAME_HEADER_SIZE bytes) */
+   void encodeFrameHeader(uint8_t* header, uint8_t messageType, uint32_t payloadSize)
+   {
+      writeUint32(header, payloadSize);
+      header[4] = messageType;
+   }
+
+   /** Encodes a frame in a buffer which can be queued on several connections */
+   FrameBuffer encodeFrame(uint8_t messageType, const uint8_t* data, size_t size)
+   {
+      auto frame = std::make_shared<std::vector<uint8_t>>(FRAME_HEADER_SIZE + size);
+      encodeFrameHeader(frame->data(), messageType, (uint32_t) size);
+
+      if (size)
+      {
+         std::memcpy(frame->data() + FRAME_HEADER_SIZE, data, size);
+      }
+
+      return frame;
+   }
+
+   /** Construction */
+   FrameReader::FrameReader(size_t capacity) :
+      mHead(0),
+      mTail(0),
+      mFrameSize(0)
+   {
+      // Round up to a power of 2, large enough for a frame header
+      size_t size = 1;
+
+      while (size < std::max(capacity, FRAME_HEADER_SIZE))
+      {
+         size *= 2;
+      }
+
+      mBuffer.resize(size);
+   }
+
+   /** Returns the contiguous free space where the next bytes can be received */
+   std::pair<uint8_t*, size_t> FrameReader::prepare()
+   {
+      release();
+
+      if (mTail - mHead == mBuffer.size())
+      {
+         grow(mBuffer.size() * 2);
+      }
+
+      size_t mask = mBuffer.size() - 1;
+      size_t free = mBuffer.size() - (mTail - mHead);
+      size_t contiguous = std::min(free, mBuffer.size() - (mTail & mask));
+
+      return std::make_pair(&mBuffer[mTail & mask], contiguous);
+   }
+
+   /** Marks bytes written in the space returned by prepare() as received */
+   void FrameReader::commit(size_t bytes)
+   {
+      mTail += bytes;
+   }
+
+   /**
+    * Extracts the next complete frame. The frame stays valid until the next call of any method.
+    * @return false if no complete frame was received
+    */
+   bool FrameReader::next(FrameView& frame)
+   {
+      release();
+
+      size_t available = mTail - mHead;
+
+      if (available < FRAME_HEADER_SIZE)
+      {
+         return false;
+      }
+
+      uint8_t sizeField[4] = { peek(0), peek(1), peek(2), peek(3) };
+      uint32_t payloadSize = readUint32(sizeField);
+
+      if (payloadSize > MAX_FRAME_SIZE)
+      {
+         throw util::Exception("Invalid frame size " + std::to_string(payloadSize));
+      }
+
+      size_t frameSize = FRAME_HEADER_SIZE + payloadSize;
+
+      if (available < frameSize)
+      {
+         if (frameSize > mBuffer.size())
+         {
+            // Make room for the rest of the frame
+            size_t capacity = mBuffer.size();
+
+            while (capacity < frameSize)
+            {
+               capacity *= 2;
+            }
+
+            grow(capacity);
+         }
+
+         return false;
+      }
+
+      size_t mask = mBuffer.size() - 1;
+      size_t start = (mHead + FRAME_HEADER_SIZE) & mask;
+
+      frame.messageType = peek(4);
+      frame.size = payloadSize;
+
+      if (start + payloadSize <= mBuffer.size())
+      {
+         frame.data = &mBuffer[start];
+      }
+      else
+      {
+         size_t first = mBuffer.size() - start;
+
+         mScratch.resize(payloadSize);
+         std::memcpy(mScratch.data(), &mBuffer[start], first);
+         std::memcpy(mScratch.data() + first, &mBuffer[0], payloadSize - first);
+
+         frame.data = mScratch.data();
+      }
+
+      mFrameSize = frameSize;
+
+      return true;
+   }
+
+   /** Releases the last frame returned by next() */
+   void FrameReader::release()
+   {
+      mHead += mFrameSize;
+      mFrameSize = 0;
+
+      if (mHead == mTail)
+      {
+         // Empty ring, restart from the beginning to keep received frames contiguous
+         mHead = mTail = 0;
+      }
+   }
+
+   /** Reallocates the ring, keeping the received bytes */
+   void FrameReader::grow(size_t capacity)
+   {
+      std::vector<uint8_t> buffer(capacity);
+      size_t available = mTail - mHead;
+
+      for (size_t i = 0; i < available; ++i)
+      {
+         buffer[i] = peek(i);
+      }
+
+      mBuffer.swap(buffer);
+      mHead = 0;
+      mTail = available;
+   }
+} // namespace qcore
@@ -1,32 +1,486 @@
 #include "QcoreUtil.h"
 #include <fstream>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <cstdlib>
+#include <cctype>
 
 namespace qcore
 {
    /** Log domain */
    const char *const DOM = "qcore::LOG";
 
-   std::ostream *util::Log::logStream = &std::cout;
+   namespace
+   {
+      /**
+       * Lines logged by one thread, waiting to be written. Single producer (the logging thread),
+       * single consumer (the writer): both only publish their position, no lock is taken.
+       */
+      class LogRing
+      {
+      public:
+
+         /** Size of the ring, a power of 2 */
+         static const size_t CAPACITY = 64 * 1024;
+
+         /** Set when the logging thread exits. The ring is released once written. */
+         std::atomic<bool> closed { false };
+
+         /** Queues a line. Returns false if there isn't enough free space. */
+         bool push(const std::string& line)
+         {
+            size_t tail = mTail.load(std::memory_order_relaxed);
+
+            if (CAPACITY - (tail - mHead.load(std::memory_order_acquire)) < line.size())
+            {
+               return false;
+            }
+
+            size_t offset = tail & (CAPACITY - 1);
+            size_t first = std::min(line.size(), CAPACITY - offset);
+
+            std::memcpy(mData.get() + offset, line.data(), first);
+            std::memcpy(mData.get(), line.data() + first, line.size() - first);
+            mTail.store(tail + line.size(), std::memory_order_release);
+
+            return true;
+         }
+
+         /** Moves the queued lines to the output buffer */
+         void drain(std::string& out)
+         {
+            size_t head = mHead.load(std::memory_order_relaxed);
+            size_t tail = mTail.load(std::memory_order_acquire);
+            size_t offset = head & (CAPACITY - 1);
+            size_t first = std::min(tail - head, CAPACITY - offset);
+
+            out.append(mData.get() + offset, first);
+            out.append(mData.get(), tail - head - first);
+            mHead.store(tail, std::memory_order_release);
+         }
+
+         /** Returns the number of queued bytes */
+         size_t size() const
+         {
+            return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+         }
+
+      private:
+
+         std::unique_ptr<char[]> mData { new char[CAPACITY] };
+
+         /** Read position, owned by the writer */
+         std::atomic<size_t> mHead { 0 };
+
+         /** Write position, owned by the logging thread */
+         std::atomic<size_t> mTail { 0 };
+      };
+
+      /**
+       * Writes the lines queued by all threads, from a background thread. Lines of one thread are
+       * written in order, lines of different threads in the order of the batches.
+       */
+      class AsyncLog
+      {
+      public:
+
+         /** Delay between two batches, unless a ring fills up */
+         static constexpr std::chrono::milliseconds BATCH_INTERVAL { 20 };
+
+         AsyncLog() :
+            mStream(&std::cout),
+            mRunning(true),
+            mStop(false),
+            mWriter([this]() { run(); })
+         {
+         }
+
+         /** Queues a line, or writes it directly once the writer stopped */
+         void write(const std::string& line)
+         {
+            if (not mRunning.load(std::memory_order_acquire))
+            {
+               std::lock_guard<std::mutex> lock(mStreamMutex);
+               *mStream << line;
+               mStream->flush();
+               return;
+            }
+
+            LogRing& ring = threadRing();
+
+            if (line.size() > LogRing::CAPACITY / 2)
+            {
+               // Written directly, after the previous lines of the thread
+               while (ring.size())
+               {
+                  wakeUp();
+               }
+
+               std::lock_guard<std::mutex> lock(mStreamMutex);
+               *mStream << line;
+               mStream->flush();
+               return;
+            }
+
+            while (not ring.push(line))
+            {
+               wakeUp();
+            }
+
+            if (ring.size() > LogRing::CAPACITY / 2)
+            {
+               mWakeCv.notify_one();
+            }
+         }
+
+         /** Writes all the queued lines, from the calling thread */
+         void flush()
+         {
+            std::lock_guard<std::mutex> lock(mDrainMutex);
+            std::string out;
+
+            std::vector<std::shared_ptr<LogRing>> rings;
+
+            {
+               std::lock_guard<std::mutex> lock(mRingsMutex);
+               rings = mRings;
+
+               // A closed ring receives no more lines after this drain
+               mRings.erase(std::remove_if(mRings.begin(), mRings.end(),
+                  [](const std::shared_ptr<LogRing>& r) { return r->closed.load(std::memory_order_acquire); }), mRings.end());
+            }
+
+            for (auto& ring : rings)
+            {
+               ring->drain(out);
+            }
+
+            if (not out.empty())
+            {
+               std::lock_guard<std::mutex> lock(mStreamMutex);
+               *mStream << out;
+               mStream->flush();
+            }
+         }
+
+         /** Stops the writer. Later lines are written directly. */
+         void stop()
+         {
+            mRunning.store(false, std::memory_order_release);
+
+            {
+               std::lock_guard<std::mutex> lock(mWakeMutex);
+               mStop = true;
+            }
+
+            mWakeCv.notify_one();
+
+#ifdef WIN32
+            // Other threads are already terminated when the DLL is unloaded, joining would hang
+            mWriter.detach();
+#else
+            mWriter.join();
+#endif
+
+            flush();
+         }
+
+         bool isRedirected()
+         {
+            std::lock_guard<std::mutex> lock(mStreamMutex);
+            return mStream == &mFile;
+         }
+
+         /** Redirects the logs to the file */
+         void redirect(const std::string& file)
+         {
+            std::lock_guard<std::mutex> redirectLock(mRedirectMutex);
+
+            if (mFile.is_open())
+            {
+               return;
+            }
+
+            // Set exceptions to be thrown on failure
+            mFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+            mFile.open(file);
+
+            // Write failures must not stop the writer thread
+            mFile.exceptions(std::ifstream::goodbit);
+
+            // The lines logged until now go to the previous stream
+            flush();
+
+            std::lock_guard<std::mutex> lock(mStreamMutex);
+            mStream = &mFile;
+         }
+
+      private:
+
+         /** Keeps the ring of a thread alive until its lines are written */
+         struct RingOwner
+         {
+            std::shared_ptr<LogRing> ring = std::make_shared<LogRing>();
+            ~RingOwner() { ring->closed.store(true, std::memory_order_release); }
+         };
+
+         /** Returns the ring of the calling thread, registered on its first line */
+         LogRing& threadRing()
+         {
+            thread_local RingOwner owner;
+            thread_local bool registered = false;
+
+            if (not registered)
+            {
+               std::lock_guard<std::mutex> lock(mRingsMutex);
+               mRings.push_back(owner.ring);
+               registered = true;
+            }
+
+            return *owner.ring;
+         }
+
+         /** Asks the writer for a batch and lets it run, or writes the batch once the writer stopped */
+         void wakeUp()
+         {
+            if (mRunning.load(std::memory_order_acquire))
+            {
+               mWakeCv.notify_one();
+               std::this_thread::yield();
+            }
+            else
+            {
+               flush();
+            }
+         }
+
+         void run()
+         {
+            std::unique_lock<std::mutex> lock(mWakeMutex);
+
+            while (not mStop)
+            {
+               mWakeCv.wait_for(lock, BATCH_INTERVAL);
+
+               lock.unlock();
+               flush();
+               lock.lock();
+            }
+         }
+
+         std::ofstream mFile;
+         std::ostream* mStream;
+         std::mutex mStreamMutex;
+         std::mutex mRedirectMutex;
+
+         std::vector<std::shared_ptr<LogRing>> mRings;
+         std::mutex mRingsMutex;
+
+         /** Serializes the consumers of the rings */
+         std::mutex mDrainMutex;
+
+         std::atomic<bool> mRunning;
+         bool mStop;
+         std::mutex mWakeMutex;
+         std::condition_variable mWakeCv;
+         std::thread mWriter;
+      };
+
+      constexpr std::chrono::milliseconds AsyncLog::BATCH_INTERVAL;
+
+      /** Never destroyed, lines may be logged by the destructors of other static objects */
+      AsyncLog& asyncLog()
+      {
+         static AsyncLog* log = new AsyncLog();
+         return *log;
+      }
+
+      /** Writes the pending lines on exit */
+      struct AsyncLogShutdown
+      {
+         ~AsyncLogShutdown() { asyncLog().stop(); }
+      } asyncLogShutdown;
+   }
+
+   std::atomic<int> util::Log::maxLevel { util::Log::Info };
+   std::atomic<bool> util::Log::domainLevels { false };
+
+   namespace
+   {
+      /** Level of the domains starting with the prefix */
+      struct DomainLevel
+      {
+         std::string prefix;
+         util::Log::Level level;
+      };
+
+      /** Levels set at runtime. Replaced (never modified) on every change, so readers don't lock. */
+      struct LogLevels
+      {
+         util::Log::Level level = util::Log::Info;
+         std::vector<DomainLevel> domains;
+      };
+
+      std::shared_ptr<const LogLevels> logLevels = std::make_shared<LogLevels>();
+
+      /** Serializes the changes of the levels */
+      std::mutex logLevelsMutex;
+
+      /** Makes the levels visible to the logging threads. Returns the highest level. */
+      int publishLevels(std::shared_ptr<const LogLevels> levels)
+      {
+         int max = levels->level;
+
+         for (auto& d : levels->domains)
+         {
+            max = std::max<int>(max, d.level);
+         }
+
+         std::atomic_store(&logLevels, levels);
+         return max;
+      }
+
+      util::Log::Level parseLevel(std::string name)
+      {
+         const char * const NAMES[] = { "error", "warn", "info", "debug", "trace" };
+         std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+
+         for (int i = 0; i <= util::Log::Trace; ++i)
+         {
+            if (name == NAMES[i])
+            {
+               return static_cast<util::Log::Level>(i);
+            }
+         }
+
+         throw util::Exception("Invalid log level: " + name);
+      }
+
+      /** Applies the QUORIDOR_LOG environment variable on startup */
+      struct LogLevelsFromEnvironment
+      {
+         LogLevelsFromEnvironment()
+         {
+            if (const char* levels = std::getenv("QUORIDOR_LOG"))
+            {
+               try
+               {
+                  util::Log::configure(levels);
+               }
+               catch (std::exception& e)
+               {
+                  std::cerr << "QUORIDOR_LOG ignored. " << e.what() << std::endl;
+               }
+            }
+         }
+      } logLevelsFromEnvironment;
+   }
 
    util::Log::~Log()
    {
-      ss << std::endl;
-      *logStream << ss.str();
-      logStream->flush();
+      ss << '\n';
+      asyncLog().write(ss.str());
    }
 
    void util::Log::init(const std::string &file)
    {
+      if (asyncLog().isRedirected())
+      {
+         // Already redirected by another game controller of the process
+         return;
+      }
+
       LOG_INFO(DOM) << "Redirecting logs to [" << file << "]";
-      static std::ofstream ofs;
+      asyncLog().redirect(file);
+   }
+
+   /** Writes all the lines logged until now */
+   void util::Log::flush()
+   {
+      asyncLog().flush();
+   }
+
+   /** Sets the level of the domains without a level of their own */
+   void util::Log::setLevel(Level level)
+   {
+      std::lock_guard<std::mutex> lock(logLevelsMutex);
+      auto levels = std::make_shared<LogLevels>(*std::atomic_load(&logLevels));
+
+      levels->level = level;
+      domainLevels.store(not levels->domains.empty());
+      maxLevel.store(publishLevels(levels));
+   }
+
+   /** Sets the level of all domains starting with the specified prefix. The longest prefix applies. */
+   void util::Log::setLevel(const std::string &domain, Level level)
+   {
+      std::lock_guard<std::mutex> lock(logLevelsMutex);
+      auto levels = std::make_shared<LogLevels>(*std::atomic_load(&logLevels));
+      auto it = std::find_if(levels->domains.begin(), levels->domains.end(), [&](const DomainLevel& d) { return d.prefix == domain; });
+
+      if (it != levels->domains.end())
+      {
+         it->level = level;
+      }
+      else
+      {
+         levels->domains.push_back({ domain, level });
+      }
+
+      domainLevels.store(not levels->domains.empty());
+      maxLevel.store(publishLevels(levels));
+   }
+
+   /**
+    * Sets the levels from a comma separated list, such as "warn,qcore::GS=trace,qplugin=debug".
+    * Levels without a domain apply to all other domains. Replaces all previous levels.
+    */
+   void util::Log::configure(const std::string &spec)
+   {
+      auto levels = std::make_shared<LogLevels>();
+      std::stringstream items(spec);
+      std::string item;
+
+      while (std::getline(items, item, ','))
+      {
+         size_t separator = item.find('=');
+
+         if (separator == std::string::npos)
+         {
+            levels->level = parseLevel(item);
+         }
+         else
+         {
+            levels->domains.push_back({ item.substr(0, separator), parseLevel(item.substr(separator + 1)) });
+         }
+      }
 
-      // Set exceptions to be thrown on failure
-      ofs.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-      ofs.open(file);
+      std::lock_guard<std::mutex> lock(logLevelsMutex);
+      domainLevels.store(not levels->domains.empty());
+      maxLevel.store(publishLevels(levels));
+   }
 
-      if (ofs.is_open())
+   bool util::Log::isDomainEnabled(Level level, const char *domain)
+   {
+      auto levels = std::atomic_load(&logLevels);
+      int threshold = levels->level;
+      size_t longest = 0;
+
+      for (auto& d : levels->domains)
       {
-         logStream = &ofs;
+         if (domain and d.prefix.size() >= longest and std::strncmp(domain, d.prefix.c_str(), d.prefix.size()) == 0)
+         {
+            threshold = d.level;
+            longest = d.prefix.size();
+         }
       }
+
+      return level <= threshold;
    }
-}
\ No newline at end of file
+}
@@ -3,8 +3,13 @@
 #include "PlayerAction.h"
 #include "RemoteGame.h"
 #include "GameServer.h"
+#include "GameController.h"
 #include "QcoreUtil.h"
 
+#include <algorithm>
+#include <array>
+#include <future>
+
 using namespace boost::asio;
 
 namespace qcore
@@ -12,27 +17,44 @@ namespace qcore
    /** Log domain */
    const char * const DOM = "qcore::RG";
 
-   /** Construction */
-   RemoteGame::RemoteGame(GameController& controller, uint8_t players, const std::string& ip) :
+   /** Construction. Connects to the game server, the game must then be joined. */
+   RemoteGame::RemoteGame(GameController& controller, uint8_t players, const std::string& ip, size_t ioThreads) :
       Game(players),
       mGameController(controller),
       mIoServiceWork(mIoService),
-      mIoServiceThread([&]{ mIoService.run(); }),
-      mSocket(mIoService, ip::tcp::v4())
+      mStrand(mIoService),
+      mSocket(mIoService, ip::tcp::v4()),
+      mNextRequestId(0),
+      mConnected(false),
+      mRemoteVersion(0)
    {
       LOG_INFO(DOM) << "Connecting to [" << ip << "] ...";
 
+      for (size_t i = 0; i < std::max<size_t>(1, ioThreads); ++i)
+      {
+         mIoThreads.emplace_back([this]{ mIoService.run(); });
+      }
+
       try
       {
          mSocket.connect(ip::tcp::endpoint(ip::address::from_string(ip), TCP_GAME_PORT));
 
-         mSocket.async_read_some(
-            buffer(mRecvData),
-            boost::bind(&RemoteGame::handleRead, this, placeholders::error, placeholders::bytes_transferred));
+         {
+            std::lock_guard<std::mutex> lock(mRequestMutex);
+            mConnected = true;
+         }
+
+         startRead();
+
+         std::string response;
+         bool result = call(GameServer::Identification, std::string { (char) PROTOCOL_VERSION } + CLIENT_ID, response);
 
-         std::string response = send(std::string {GameServer::Identification} + CLIENT_ID);
+         if (not result)
+         {
+            throw util::Exception("Handshake failed: " + response);
+         }
 
-         if (response.at(0) != GameServer::ServerResponse and response.substr(1) != SERVER_ID)
+         if (response.empty() or (uint8_t) response.at(0) != PROTOCOL_VERSION or response.substr(1) != SERVER_ID)
          {
             throw util::Exception("Handshake failed");
          }
@@ -40,28 +62,155 @@ namespace qcore
       catch (...)
       {
          mIoService.stop();
-         mIoServiceThread.join();
+
+         for (auto& t : mIoThreads)
+         {
+            t.join();
+         }
+
          throw;
       }
    }
 
+   /** Destruction. Pending requests fail. */
+   RemoteGame::~RemoteGame()
+   {
+      mIoService.stop();
+
+      for (auto& t : mIoThreads)
+      {
+         t.join();
+      }
+
+      disconnect("Game closed");
+   }
+
+   /** Lists the games hosted by the server */
+   std::list<GameInfo> RemoteGame::listGames()
+   {
+      std::string response;
+
+      if (not call(GameServer::ListGames, std::string(), response))
+      {
+         throw util::Exception("List games failed: " + response);
+      }
+
+      // Count, then for each game: ID, number of players, name length and name
+      auto data = reinterpret_cast<const uint8_t*>(response.data());
+      size_t size = response.size();
+      size_t offset = sizeof(uint32_t);
+
+      if (size < offset)
+      {
+         throw util::Exception("List games failed: Invalid response");
+      }
+
+      std::list<GameInfo> games;
+      uint32_t count = readUint32(data);
+
+      for (uint32_t i = 0; i < count; ++i)
+      {
+         if (size < offset + sizeof(GameId) + 2 or size < offset + sizeof(GameId) + 2 + data[offset + sizeof(GameId) + 1])
+         {
+            throw util::Exception("List games failed: Invalid response");
+         }
+
+         GameInfo game;
+         game.id = readUint32(data + offset);
+         game.numberOfPlayers = data[offset + sizeof(GameId)];
+         size_t nameSize = data[offset + sizeof(GameId) + 1];
+         offset += sizeof(GameId) + 2;
+
+         game.name.assign(response, offset, nameSize);
+         offset += nameSize;
+
+         games.push_back(game);
+      }
+
+      return games;
+   }
+
+   /** Joins one of the games hosted by the server. The other requests are routed to this game. */
+   void RemoteGame::joinGame(GameId gameId)
+   {
+      uint8_t payload[sizeof(GameId)];
+      writeUint32(payload, gameId);
+
+      std::string response;
+
+      if (not call(GameServer::JoinGame, payload, sizeof(payload), response))
+      {
+         throw util::Exception("Join game failed: " + response);
+      }
+
+      LOG_INFO(DOM) << "Joined game [" << gameId << "]";
+   }
+
    /** Adds a player to the remote game server */
    PlayerId RemoteGame::addRemotePlayer(const std::string& playerName)
    {
-      std::string request = std::string { GameServer::AddRemotePlayer } + playerName;
-      std::string response = send(request);
+      std::string response;
 
-      if (response.at(0) != GameServer::ServerResponse)
+      if (not call(GameServer::AddRemotePlayer, playerName, response))
+      {
+         throw util::Exception("Add Remote Player failed: " + response);
+      }
+
+      if (response.size() != 1)
       {
          throw util::Exception("Add Remote Player failed: Invalid response");
       }
 
-      if (response.at(1) != 0)
+      return response.at(0);
+   }
+
+   /**
+    * Follows the game as a spectator: loads the current board, then receives its updates,
+    * grouped at the specified interval if not zero
+    */
+   void RemoteGame::spectate(std::chrono::milliseconds batchInterval)
+   {
+      uint16_t batchMs = (uint16_t) std::min<int64_t>(batchInterval.count(), MAX_SPECTATOR_BATCH_MS);
+      uint8_t payload[] = { uint8_t(batchMs), uint8_t(batchMs >> 8) };
+      std::promise<std::string> result;
+
+      // The snapshot is loaded from the IO thread, before any update following it is processed
+      request(GameServer::JoinSpectator, payload, sizeof(payload), [&](bool success, const std::string& data)
       {
-         throw util::Exception("Add Remote Player failed: " + response.substr(1));
+         try
+         {
+            if (not success)
+            {
+               throw util::Exception(data);
+            }
+
+            auto snapshot = BoardSnapshot::decode(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+            PlayerAction last = snapshot->getLastAction();
+
+            {
+               std::lock_guard<std::mutex> lock(mMutex);
+               mCurrentPlayer = last.actionType == ActionType::Invalid ? 0 : (last.playerId + 1) % snapshot->getPlayers(0).size();
+            }
+
+            mRemoteVersion = snapshot->getVersion();
+            mBoardState->load(snapshot);
+            result.set_value(std::string());
+         }
+         catch (std::exception& e)
+         {
+            result.set_value(e.what());
+         }
+      });
+
+      std::string error = result.get_future().get();
+
+      if (not error.empty())
+      {
+         throw util::Exception("Join as spectator failed: " + error);
       }
 
-      return response.at(2);
+      LOG_INFO(DOM) << "Spectating game at board version " << mBoardState->getSnapshot()->getVersion();
+      mBoardState->notifyStateChange();
    }
 
    /** Validates and sets the next user action */
@@ -69,40 +218,147 @@ namespace qcore
    {
       LOG_DEBUG(DOM) << "Sending player action ...";
 
-      std::string request = std::string { GameServer::PlayerAction } + action.serialize();
-      std::string response = send(request);
-      bool result = false;
+      uint8_t record[PlayerAction::ENCODED_SIZE];
+      action.encode(record);
+
+      bool result = call(GameServer::PlayerAction, record, sizeof(record), reason);
 
-      if (response.at(0) != GameServer::ServerResponse)
+      if (not result)
       {
-         LOG_ERROR(DOM) << "Received invalid response";
+         LOG_WARN(DOM) << reason;
       }
-      else if (response.at(1) != 0)
+
+      return result;
+   }
+
+   /** Sends the next user action, without waiting for the server to process it */
+   void RemoteGame::processPlayerActionAsync(const PlayerAction& action, ResponseCb callback)
+   {
+      uint8_t record[PlayerAction::ENCODED_SIZE];
+      action.encode(record);
+
+      request(GameServer::PlayerAction, record, sizeof(record), std::move(callback));
+   }
+
+   /** Asks the server if the action is valid, without applying it */
+   bool RemoteGame::validateAction(const PlayerAction& action, std::string& reason)
+   {
+      uint8_t record[PlayerAction::ENCODED_SIZE];
+      action.encode(record);
+
+      return call(GameServer::ValidateAction, record, sizeof(record), reason);
+   }
+
+   /** Asks the server if the action is valid, without applying it */
+   void RemoteGame::validateActionAsync(const PlayerAction& action, ResponseCb callback)
+   {
+      uint8_t record[PlayerAction::ENCODED_SIZE];
+      action.encode(record);
+
+      request(GameServer::ValidateAction, record, sizeof(record), std::move(callback));
+   }
+
+   /**
+    * Sends a request to the remote game server. The callback is called from the IO thread and must
+    * not wait for other requests.
+    */
+   void RemoteGame::request(uint8_t messageType, const uint8_t* data, size_t size, ResponseCb callback)
+   {
+      RequestId requestId;
+
       {
-         reason = response.substr(2);
-         LOG_WARN(DOM) << reason;
+         // Registered before sending, the response may arrive before write() returns
+         std::lock_guard<std::mutex> lock(mRequestMutex);
+
+         if (not mConnected)
+         {
+            throw util::Exception("Not connected to the game server");
+         }
+
+         requestId = mNextRequestId++;
+         mPendingRequests.emplace(requestId, std::move(callback));
       }
-      else
+
+      LOG_DEBUG(DOM) << "Sending request [" << requestId << "] type [" << (int) messageType << "] size [" << size << "]";
+
+      uint8_t header[FRAME_HEADER_SIZE + REQUEST_HEADER_SIZE];
+      encodeFrameHeader(header, messageType, (uint32_t) (REQUEST_HEADER_SIZE + size));
+      writeUint32(header + FRAME_HEADER_SIZE, requestId);
+
+      std::array<const_buffer, 2> buffers = {{ buffer(header), buffer(data, size) }};
+
+      try
+      {
+         std::lock_guard<std::mutex> lock(mSendMutex);
+         boost::asio::write(mSocket, buffers);
+      }
+      catch (...)
       {
-         result = true;
+         std::lock_guard<std::mutex> lock(mRequestMutex);
+         mPendingRequests.erase(requestId);
+         throw;
       }
+   }
 
-      return result;
+   /**
+    * Sends a request and waits for the response. Must not be called from a response callback.
+    * @return false if the server rejected the request, with the reason in result
+    */
+   bool RemoteGame::call(uint8_t messageType, const uint8_t* data, size_t size, std::string& result)
+   {
+      if (mStrand.running_in_this_thread())
+      {
+         throw util::Exception("Blocking request from the IO thread");
+      }
+
+      auto promise = std::make_shared<std::promise<std::pair<bool, std::string>>>();
+      auto future = promise->get_future();
+
+      request(messageType, data, size, [promise](bool success, const std::string& data)
+      {
+         promise->set_value(std::make_pair(success, data));
+      });
+
+      auto response = future.get();
+      result = response.second;
+
+      return response.first;
    }
 
-   /** Sends a message to the remote game server */
-   std::string RemoteGame::send(const std::string& message)
+   /**
+    * Sends a request and waits for the response. Must not be called from a response callback.
+    * @return false if the server rejected the request, with the reason in result
+    */
+   bool RemoteGame::call(uint8_t messageType, const std::string& payload, std::string& result)
    {
-      LOG_DEBUG(DOM) << "Sending message type [" << (int) message.at(0) << "] size [" << message.size() << "]";
+      return call(messageType, reinterpret_cast<const uint8_t*>(payload.data()), payload.size(), result);
+   }
 
+   /** Fails all pending requests, after the connection was lost */
+   void RemoteGame::disconnect(const std::string& reason)
+   {
+      std::unordered_map<RequestId, ResponseCb> pending;
+
+      {
+         std::lock_guard<std::mutex> lock(mRequestMutex);
+         mConnected = false;
+         pending.swap(mPendingRequests);
+      }
+
+      for (auto& r : pending)
       {
-         // Reset the promise
-         std::lock_guard<std::mutex> lock(mMutex);
-         mPromiseResponse = std::promise<std::string>();
+         r.second(false, reason);
       }
+   }
+
+   /** Receives the next bytes directly into the frame reader */
+   void RemoteGame::startRead()
+   {
+      auto space = mReader.prepare();
 
-      boost::asio::write(mSocket, buffer(char(message.size()) + message));
-      return mPromiseResponse.get_future().get();
+      mSocket.async_read_some(
+         buffer(space.first, space.second),
+         mStrand.wrap(boost::bind(&RemoteGame::handleRead, this, placeholders::error, placeholders::bytes_transferred)));
    }
 
    /** Handles socket read */
@@ -110,53 +366,83 @@ namespace qcore
    {
       if (not error)
       {
-         mRecvBuffer += std::string(mRecvData.c_array(), bytesTransferred);
+         mReader.commit(bytesTransferred);
 
-         while ((uint8_t) mRecvBuffer[0] >= mRecvBuffer.size() - 1)
+         try
          {
-            processMessage(mRecvBuffer.substr(1, mRecvBuffer[0]));
-            mRecvBuffer.erase(0, mRecvBuffer[0] + 1);
-         }
+            FrameView frame;
 
-         // TODO: Detect invalid message and clear buffer
+            while (mReader.next(frame))
+            {
+               processMessage(frame);
+            }
+         }
+         catch (std::exception& e)
+         {
+            LOG_ERROR(DOM) << "Invalid message from server: " << e.what();
+            mSocket.close();
+            disconnect("Invalid message from server");
+            return;
+         }
 
-         mSocket.async_read_some(
-            buffer(mRecvData),
-            boost::bind(&RemoteGame::handleRead, this, placeholders::error, placeholders::bytes_transferred));
+         startRead();
       }
       else
       {
          LOG_WARN(DOM) << "Client disconnected: " << error.message();
+         disconnect("Connection lost: " + error.message());
 
          // TODO: stop game
       }
    }
 
    /** Processes the message received from the remote game server */
-   void RemoteGame::processMessage(const std::string& message)
+   void RemoteGame::processMessage(const FrameView& frame)
    {
       try
       {
-         char messageType = message.at(0);
-         LOG_DEBUG(DOM) << "Received message type [" << (int) messageType << "] size [" << message.size() << "]";
+         LOG_DEBUG(DOM) << "Received message type [" << (int) frame.messageType << "] size [" << frame.size << "]";
 
-         switch (messageType)
+         switch (frame.messageType)
          {
             case GameServer::ServerResponse:
             {
-               std::lock_guard<std::mutex> lock(mMutex);
-               mPromiseResponse.set_value(message);
+               if (frame.size < RESPONSE_HEADER_SIZE)
+               {
+                  throw util::Exception("Invalid message format");
+               }
+
+               RequestId requestId = readUint32(frame.data);
+               ResponseCb callback;
+
+               {
+                  std::lock_guard<std::mutex> lock(mRequestMutex);
+                  auto it = mPendingRequests.find(requestId);
+
+                  if (it == mPendingRequests.end())
+                  {
+                     throw util::Exception("Response to unknown request " + std::to_string(requestId));
+                  }
+
+                  callback = std::move(it->second);
+                  mPendingRequests.erase(it);
+               }
+
+               bool success = frame.data[sizeof(RequestId)] == 0;
+               std::string data(reinterpret_cast<const char*>(frame.data) + RESPONSE_HEADER_SIZE, frame.size - RESPONSE_HEADER_SIZE);
+
+               callback(success, data);
                break;
             }
 
             case GameServer::RequestPlayerNextMove:
             {
-               if (message.size() != 2 )
+               if (frame.size != 1)
                {
                   throw util::Exception("Invalid message format");
                }
 
-               PlayerId playerId = message.at(1);
+               PlayerId playerId = frame.data[0];
                LOG_DEBUG(DOM) << "Calling next action for player " << (int) playerId << " ...";
 
                {
@@ -164,17 +450,38 @@ namespace qcore
                   mCurrentPlayer = playerId;
                }
 
-               mGameController.getPlayer(playerId)->notifyMove();
+               // The player sends his action through this connection, so he can't run on the IO thread
+               mGameController.notifyRemoteMove(playerId);
 
                break;
             }
 
             case GameServer::BoardStateUpdate:
             {
+               if (frame.size != sizeof(uint32_t) + PlayerAction::ENCODED_SIZE)
+               {
+                  throw util::Exception("Invalid message format");
+               }
+
+               uint32_t version = readUint32(frame.data);
+
+               if (version <= mRemoteVersion)
+               {
+                  // Already part of the snapshot received when joining
+                  break;
+               }
+
                PlayerAction action;
-               action.deserialize(message.substr(1));
+               action.decode(frame.data + sizeof(uint32_t));
                mBoardState->applyAction(action);
+               mRemoteVersion = version;
+
+               {
+                  std::lock_guard<std::mutex> lock(mMutex);
+                  mCurrentPlayer = (action.playerId + 1) % mBoardState->getSnapshot()->getPlayers(0).size();
+               }
 
+               mBoardState->notifyStateChange();
                break;
             }
 
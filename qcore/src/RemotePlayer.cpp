@@ -14,7 +14,8 @@ namespace qcore
    void RemotePlayer::doNextMove()
    {
 #if BOOST_AVAILABLE
-      mRemoteSession->send(std::string({ GameServer::RequestPlayerNextMove, (char) getId() }));
+      PlayerId id = getId();
+      mRemoteSession->send(GameServer::RequestPlayerNextMove, &id, sizeof(id));
 #endif
    }
 
@@ -0,0 +1,396 @@
+#include "SearchState.h"
+#include "BoardSnapshot.h"
+
+#include <type_traits>
+
+namespace qcore
+{
+   static_assert(std::is_trivially_copyable<SearchState>::value, "SearchState must be trivially copyable");
+   static_assert(sizeof(SearchState) <= 64, "SearchState must fit in a cache line");
+
+   /** All step directions */
+   static const Direction DIRECTIONS[] = { Direction::Up, Direction::Down, Direction::Left, Direction::Right };
+
+   /** Returns the wall with its middle point on the specified slot */
+   static WallState slotWall(Orientation o, uint8_t slot)
+   {
+      WallState wall;
+      wall.orientation = o;
+      wall.position = o == Orientation::Vertical ?
+         Position(slot / WALL_SLOTS, slot % WALL_SLOTS + 1) :
+         Position(slot / WALL_SLOTS + 1, slot % WALL_SLOTS);
+
+      return wall;
+   }
+
+   /** Marks the wall slots blocking a step, ignoring slots outside board's boundaries */
+   static void addStepCuts(const Position& p, Direction d, uint64_t cuts[2])
+   {
+      // Same slots as the ones checked by BitBoard::isBlocked
+      Orientation o = d == Direction::Up or d == Direction::Down ? Orientation::Horizontal : Orientation::Vertical;
+      int row = d == Direction::Up or d == Direction::Left or d == Direction::Right ? p.x - 1 : p.x;
+      int column = d == Direction::Right ? p.y : p.y - 1;
+
+      // The two slots at the ends of the edge crossed by the step
+      int rows[2] = { row, d == Direction::Left or d == Direction::Right ? row + 1 : row };
+      int columns[2] = { column, d == Direction::Left or d == Direction::Right ? column : column + 1 };
+
+      for (int i = 0; i < 2; ++i)
+      {
+         if (rows[i] >= 0 and rows[i] < WALL_SLOTS and columns[i] >= 0 and columns[i] < WALL_SLOTS)
+         {
+            cuts[static_cast<int>(o)] |= uint64_t(1) << (rows[i] * WALL_SLOTS + columns[i]);
+         }
+      }
+   }
+
+   /** Construction of the initial state of a game */
+   SearchState::SearchState(uint8_t players, uint8_t walls) :
+      SearchState(BoardSnapshot(players, walls), 0)
+   {
+   }
+
+   /** Construction from a board of a game, with the specified player on move */
+   SearchState::SearchState(const BoardSnapshot& snapshot, PlayerId currentPlayer) :
+      mBoard(snapshot.getBitBoard()),
+      mWallsLeft{},
+      mNumberOfPlayers(uint8_t(snapshot.getPlayers(0).size())),
+      mCurrentPlayer(currentPlayer),
+      mWinner(snapshot.isFinished() ? snapshot.getWinner() : 0xFF)
+   {
+      for (PlayerId id = 0; id < mNumberOfPlayers; ++id)
+      {
+         mWallsLeft[id] = snapshot.getWallsLeft(id);
+      }
+
+      mHash = ZOBRIST.hash(mBoard, mWallsLeft, mNumberOfPlayers, mCurrentPlayer);
+   }
+
+   /** Returns the number of steps the player needs to reach his goal, ignoring other pawns. 0xFF if blocked. */
+   uint8_t SearchState::getGoalDistance(PlayerId id) const
+   {
+      uint8_t queue[BOARD_SQUARES];
+      uint8_t dist[BOARD_SQUARES];
+      bool visited[BOARD_SQUARES] = {};
+      uint8_t head = 0;
+      uint8_t tail = 0;
+
+      uint8_t start = BitBoard::square(mBoard.getPawn(id));
+      queue[tail++] = start;
+      visited[start] = true;
+      dist[start] = 0;
+
+      while (head != tail)
+      {
+         uint8_t sq = queue[head++];
+         Position p = BitBoard::position(sq);
+
+         if (BitBoard::isGoal(p, mBoard.getInitialState(id)))
+         {
+            return dist[sq];
+         }
+
+         for (Direction d : DIRECTIONS)
+         {
+            if (not mBoard.isBlocked(p, d))
+            {
+               uint8_t next = BitBoard::square(p + d);
+
+               if (not visited[next])
+               {
+                  visited[next] = true;
+                  dist[next] = dist[sq] + 1;
+                  queue[tail++] = next;
+               }
+            }
+         }
+      }
+
+      return 0xFF;
+   }
+
+   /** Writes the pawn moves of the player on move, at most MAX_PAWN_MOVES. Returns their number. */
+   size_t SearchState::generateMoves(PlayerAction* moves) const
+   {
+      if (isFinished())
+      {
+         return 0;
+      }
+
+      Position from = mBoard.getPawn(mCurrentPlayer);
+      size_t count = 0;
+
+      auto add = [&](const Position& to)
+      {
+         for (size_t i = 0; i < count; ++i)
+         {
+            // Side steps around two pawns can reach the same square
+            if (moves[i].playerPosition == to)
+            {
+               return;
+            }
+         }
+
+         moves[count].actionType = ActionType::Move;
+         moves[count].playerId = mCurrentPlayer;
+         moves[count].playerPosition = to;
+         ++count;
+      };
+
+      for (Direction d : DIRECTIONS)
+      {
+         if (mBoard.isBlocked(from, d))
+         {
+            continue;
+         }
+
+         Position next = from + d;
+
+         if (not mBoard.isPawn(next))
+         {
+            add(next);
+            continue;
+         }
+
+         // Jump over the pawn
+         if (not mBoard.isBlocked(next, d) and not mBoard.isPawn(next + d))
+         {
+            add(next + d);
+         }
+
+         // Step to a side of the pawn
+         for (Direction side : DIRECTIONS)
+         {
+            if (side != d and side != rotate(d, 2) and not mBoard.isBlocked(next, side) and not mBoard.isPawn(next + side))
+            {
+               add(next + side);
+            }
+         }
+      }
+
+      return count;
+   }
+
+   /** Writes the wall placements of the player on move, at most MAX_WALL_PLACEMENTS. Returns their number. */
+   size_t SearchState::generateWalls(PlayerAction* walls) const
+   {
+      if (isFinished() or mWallsLeft[mCurrentPlayer] == 0)
+      {
+         return 0;
+      }
+
+      size_t count = 0;
+      uint64_t cuts[2] = {};
+      getPathCuts(cuts);
+
+      for (Orientation o : { Orientation::Vertical, Orientation::Horizontal })
+      {
+         uint64_t free = mBoard.getFreeWallSlots(o);
+         uint64_t cut = cuts[static_cast<int>(o)];
+
+         for (uint8_t slot = 0; free; ++slot, free >>= 1, cut >>= 1)
+         {
+            if (not (free & 1))
+            {
+               continue;
+            }
+
+            WallState wall = slotWall(o, slot);
+
+            // Only the walls cutting a shortest path may block a player
+            if (not (cut & 1) or isWallLeavingPaths(wall))
+            {
+               walls[count].actionType = ActionType::Wall;
+               walls[count].playerId = mCurrentPlayer;
+               walls[count].wallState = wall;
+               ++count;
+            }
+         }
+      }
+
+      return count;
+   }
+
+   /** Writes all actions of the player on move, at most MAX_ACTIONS. Returns their number. */
+   size_t SearchState::generateActions(PlayerAction* actions) const
+   {
+      size_t count = generateMoves(actions);
+      return count + generateWalls(actions + count);
+   }
+
+   /** Checks if the action is legal for the player on move */
+   bool SearchState::isLegal(const PlayerAction& action) const
+   {
+      if (isFinished() or action.playerId != mCurrentPlayer)
+      {
+         return false;
+      }
+
+      if (action.actionType == ActionType::Move)
+      {
+         PlayerAction moves[MAX_PAWN_MOVES];
+         size_t count = generateMoves(moves);
+
+         for (size_t i = 0; i < count; ++i)
+         {
+            if (moves[i].playerPosition == action.playerPosition)
+            {
+               return true;
+            }
+         }
+
+         return false;
+      }
+
+      return action.actionType == ActionType::Wall and mWallsLeft[mCurrentPlayer] and
+         BitBoard::isWallOnBoard(action.wallState) and isWallLegal(action.wallState);
+   }
+
+   /** Applies a legal action in place and returns what is needed to undo it */
+   ActionUndo SearchState::doAction(const PlayerAction& action)
+   {
+      ActionUndo undo;
+      undo.playerId = action.playerId;
+      undo.square = NO_SQUARE;
+      undo.wallSlot = 0;
+      undo.orientation = action.wallState.orientation;
+
+      if (action.actionType == ActionType::Move)
+      {
+         undo.square = BitBoard::square(mBoard.getPawn(action.playerId));
+         mBoard.movePawn(action.playerId, action.playerPosition);
+         mHash ^= ZOBRIST.pawn(action.playerId, undo.square) ^ ZOBRIST.pawn(action.playerId, BitBoard::square(action.playerPosition));
+
+         if (BitBoard::isGoal(action.playerPosition, mBoard.getInitialState(action.playerId)))
+         {
+            mWinner = action.playerId;
+         }
+      }
+      else
+      {
+         undo.wallSlot = BitBoard::wallSlot(action.wallState);
+         mBoard.placeWall(action.wallState);
+         mHash ^= ZOBRIST.wall(undo.orientation, undo.wallSlot) ^ ZOBRIST.wallsLeft(action.playerId, mWallsLeft[action.playerId]);
+         --mWallsLeft[action.playerId];
+         mHash ^= ZOBRIST.wallsLeft(action.playerId, mWallsLeft[action.playerId]);
+      }
+
+      mCurrentPlayer = (action.playerId + 1) % mNumberOfPlayers;
+      mHash ^= ZOBRIST.side(action.playerId) ^ ZOBRIST.side(mCurrentPlayer);
+      return undo;
+   }
+
+   /** Restores the state before the action. Actions are undone in the reverse order. */
+   void SearchState::undoAction(const ActionUndo& undo)
+   {
+      if (undo.square != NO_SQUARE)
+      {
+         mHash ^= ZOBRIST.pawn(undo.playerId, BitBoard::square(mBoard.getPawn(undo.playerId))) ^ ZOBRIST.pawn(undo.playerId, undo.square);
+         mBoard.movePawn(undo.playerId, BitBoard::position(undo.square));
+      }
+      else
+      {
+         mBoard.removeWall(undo.orientation, undo.wallSlot);
+         mHash ^= ZOBRIST.wall(undo.orientation, undo.wallSlot) ^ ZOBRIST.wallsLeft(undo.playerId, mWallsLeft[undo.playerId]);
+         ++mWallsLeft[undo.playerId];
+         mHash ^= ZOBRIST.wallsLeft(undo.playerId, mWallsLeft[undo.playerId]);
+      }
+
+      // Actions can't be made after the end of the game
+      mWinner = 0xFF;
+      mHash ^= ZOBRIST.side(mCurrentPlayer) ^ ZOBRIST.side(undo.playerId);
+      mCurrentPlayer = undo.playerId;
+   }
+
+   /** Converts an action to the perspective of the player making it, as expected by the game */
+   PlayerAction SearchState::toRelative(const PlayerAction& action) const
+   {
+      return action.rotate(static_cast<int>(mBoard.getInitialState(action.playerId)));
+   }
+
+   /** Checks if the wall can be placed without intersecting another one or blocking a player */
+   bool SearchState::isWallLegal(const WallState& wall) const
+   {
+      return not mBoard.isWallIntersecting(wall) and isWallLeavingPaths(wall);
+   }
+
+   /** Checks if the wall, intersecting no other one, leaves a path to goal for every player */
+   bool SearchState::isWallLeavingPaths(const WallState& wall) const
+   {
+      BitBoard board = mBoard;
+      board.placeWall(wall);
+
+      for (PlayerId id = 0; id < mNumberOfPlayers; ++id)
+      {
+         if (not board.hasPathToGoal(id))
+         {
+            return false;
+         }
+      }
+
+      return true;
+   }
+
+   /**
+    * Marks the wall slots cutting a shortest path to goal of any player, indexed by Orientation.
+    * Walls on the other slots leave all the paths open.
+    */
+   void SearchState::getPathCuts(uint64_t cuts[2]) const
+   {
+      for (PlayerId id = 0; id < mNumberOfPlayers; ++id)
+      {
+         uint8_t queue[BOARD_SQUARES];
+         uint8_t parent[BOARD_SQUARES];
+         Direction step[BOARD_SQUARES];
+         bool visited[BOARD_SQUARES] = {};
+         uint8_t head = 0;
+         uint8_t tail = 0;
+         uint8_t goal = NO_SQUARE;
+
+         uint8_t start = BitBoard::square(mBoard.getPawn(id));
+         queue[tail++] = start;
+         visited[start] = true;
+
+         while (head != tail and goal == NO_SQUARE)
+         {
+            uint8_t sq = queue[head++];
+            Position p = BitBoard::position(sq);
+
+            if (BitBoard::isGoal(p, mBoard.getInitialState(id)))
+            {
+               goal = sq;
+               break;
+            }
+
+            for (Direction d : DIRECTIONS)
+            {
+               if (not mBoard.isBlocked(p, d))
+               {
+                  uint8_t next = BitBoard::square(p + d);
+
+                  if (not visited[next])
+                  {
+                     visited[next] = true;
+                     parent[next] = sq;
+                     step[next] = d;
+                     queue[tail++] = next;
+                  }
+               }
+            }
+         }
+
+         if (goal == NO_SQUARE)
+         {
+            // Without a path every wall must be checked
+            cuts[0] = cuts[1] = ~uint64_t(0);
+            return;
+         }
+
+         for (uint8_t sq = goal; sq != start; sq = parent[sq])
+         {
+            addStepCuts(BitBoard::position(parent[sq]), step[sq], cuts);
+         }
+      }
+   }
+
+} // namespace qcore
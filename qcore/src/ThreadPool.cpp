@@ -0,0 +1,190 @@
+#include "ThreadPool.h"
+#include "QcoreUtil.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+namespace qcore
+{
+   /** Log domain */
+   const char * const DOM = "qcore::TP";
+
+   /** Construction. By default, one worker is started for each hardware thread. */
+   ThreadPool::ThreadPool(size_t threads) :
+      mPendingTasks(0),
+      mStopped(false)
+   {
+      if (threads == 0)
+      {
+         threads = std::max(1u, std::thread::hardware_concurrency());
+      }
+
+      LOG_DEBUG(DOM) << "Starting " << threads << " worker threads";
+
+      for (size_t i = 0; i < threads; ++i)
+      {
+         mWorkers.emplace_back(new Worker());
+      }
+
+      for (size_t i = 0; i < threads; ++i)
+      {
+         mWorkers[i]->thread = std::thread(&ThreadPool::run, this, i);
+      }
+   }
+
+   /** Destruction. Waits for the running tasks, the queued ones are dropped. */
+   ThreadPool::~ThreadPool()
+   {
+      {
+         std::lock_guard<std::mutex> lock(mMutex);
+         mStopped = true;
+
+         for (auto& w : mWorkers)
+         {
+            w->cv.notify_all();
+         }
+      }
+
+      for (auto& w : mWorkers)
+      {
+         w->thread.join();
+      }
+   }
+
+   /**
+    * Returns the pool shared by all games of the process. Its size is read from
+    * QUORIDOR_WORKER_THREADS, defaulting to the number of hardware threads.
+    */
+   std::shared_ptr<ThreadPool> ThreadPool::Shared()
+   {
+      static std::shared_ptr<ThreadPool> pool = []()
+      {
+         const char *env = std::getenv("QUORIDOR_WORKER_THREADS");
+         return std::make_shared<ThreadPool>(env ? std::stoul(env) : 0);
+      }();
+
+      return pool;
+   }
+
+   /** Queues a task to be executed by one of the workers */
+   void ThreadPool::post(Task task, size_t affinity)
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      ++mPendingTasks;
+
+      if (affinity == NO_AFFINITY)
+      {
+         mTasks.push_back(std::move(task));
+         wakeUp(NO_AFFINITY);
+      }
+      else
+      {
+         size_t index = affinity % mWorkers.size();
+         mWorkers[index]->tasks.push_back(std::move(task));
+         wakeUp(index);
+      }
+   }
+
+   /** Blocks until all posted tasks have finished */
+   void ThreadPool::wait()
+   {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mIdleCv.wait(lock, [&]{ return mPendingTasks == 0; });
+   }
+
+   /** Worker thread loop */
+   void ThreadPool::run(size_t index)
+   {
+      Worker& worker = *mWorkers[index];
+      std::unique_lock<std::mutex> lock(mMutex);
+
+      while (not mStopped)
+      {
+         Task task;
+
+         if (not nextTask(index, task))
+         {
+            worker.idle = true;
+            worker.cv.wait(lock);
+            worker.idle = false;
+            continue;
+         }
+
+         lock.unlock();
+
+         try
+         {
+            task();
+         }
+         catch (std::exception& e)
+         {
+            LOG_ERROR(DOM) << "Task failed: " << e.what();
+         }
+
+         // Release task's resources before taking the lock
+         task = nullptr;
+         lock.lock();
+
+         if (--mPendingTasks == 0)
+         {
+            mIdleCv.notify_all();
+         }
+      }
+   }
+
+   /** Picks the next task for a worker: its own first, then shared ones, then other workers' */
+   bool ThreadPool::nextTask(size_t index, Task& task)
+   {
+      std::deque<Task>* queue = nullptr;
+
+      if (not mWorkers[index]->tasks.empty())
+      {
+         queue = &mWorkers[index]->tasks;
+      }
+      else if (not mTasks.empty())
+      {
+         queue = &mTasks;
+      }
+      else
+      {
+         for (size_t i = 1; i < mWorkers.size() and not queue; ++i)
+         {
+            auto& other = mWorkers[(index + i) % mWorkers.size()]->tasks;
+            queue = other.empty() ? nullptr : &other;
+         }
+      }
+
+      if (not queue)
+      {
+         return false;
+      }
+
+      task = std::move(queue->front());
+      queue->pop_front();
+
+      return true;
+   }
+
+   /** Wakes up an idle worker, preferably the specified one */
+   void ThreadPool::wakeUp(size_t preferred)
+   {
+      // Idle flags are cleared here so that the next post wakes up another worker
+      if (preferred != NO_AFFINITY and mWorkers[preferred]->idle)
+      {
+         mWorkers[preferred]->idle = false;
+         mWorkers[preferred]->cv.notify_one();
+         return;
+      }
+
+      for (auto& w : mWorkers)
+      {
+         if (w->idle)
+         {
+            w->idle = false;
+            w->cv.notify_one();
+            return;
+         }
+      }
+   }
+} // namespace qcore
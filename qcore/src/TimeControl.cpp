@@ -0,0 +1,54 @@
+#include "TimeControl.h"
+
+#include <algorithm>
+
+namespace qcore
+{
+   /** Construction */
+   PlayerClock::PlayerClock(const TimeControl& timeControl) :
+      mTimeControl(timeControl),
+      mRemaining(timeControl.budget)
+   {
+   }
+
+   /** Returns the moment the player runs out of time, for a move started now. Clock::time_point::max() if not limited. */
+   PlayerClock::Clock::time_point PlayerClock::getDeadline(Clock::time_point moveStart) const
+   {
+      if (not isLimited())
+      {
+         return Clock::time_point::max();
+      }
+
+      std::chrono::milliseconds allowed = std::chrono::milliseconds::max();
+
+      if (mTimeControl.budget.count())
+      {
+         allowed = std::max(mRemaining, std::chrono::milliseconds(0));
+      }
+
+      if (mTimeControl.moveLimit.count())
+      {
+         allowed = std::min(allowed, mTimeControl.moveLimit);
+      }
+
+      return moveStart + allowed;
+   }
+
+   /**
+    * Charges the duration of a move and adds the increment
+    * @return false if the player exceeded his time
+    */
+   bool PlayerClock::stop(std::chrono::milliseconds elapsed)
+   {
+      bool inTime = not mTimeControl.moveLimit.count() or elapsed <= mTimeControl.moveLimit;
+
+      if (mTimeControl.budget.count())
+      {
+         mRemaining -= elapsed;
+         inTime = inTime and mRemaining.count() >= 0;
+         mRemaining += mTimeControl.increment;
+      }
+
+      return inTime;
+   }
+} // namespace qcore
@@ -0,0 +1,255 @@
+#include "Tournament.h"
+#include "ThreadPool.h"
+#include "PluginManager.h"
+#include "Player.h"
+#include "Game.h"
+#include "QcoreUtil.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace qcore
+{
+   /** Log domain */
+   const char * const DOM = "qcore::TR";
+
+   /** Construction. Pairs every plugin with all the others. */
+   Tournament::Tournament(const std::list<std::string>& plugins, const TournamentSettings& settings) :
+      mSettings(settings),
+      mPlugins(plugins.begin(), plugins.end()),
+      mFinishedGames(0)
+   {
+      if (mPlugins.size() < 2)
+      {
+         throw util::Exception("At least two plugins are needed for a tournament");
+      }
+
+      for (auto& p : mPlugins)
+      {
+         if (not PluginManager::PluginAvailable(p))
+         {
+            throw util::Exception("Invalid plugin name: " + p);
+         }
+      }
+
+      // Play all pairs once before any rematch, so partial results stay balanced
+      for (uint32_t round = 0; round < mSettings.gamesPerPair; ++round)
+      {
+         for (size_t i = 0; i < mPlugins.size(); ++i)
+         {
+            for (size_t j = i + 1; j < mPlugins.size(); ++j)
+            {
+               GameResult game;
+               game.plugins[round & 1] = mPlugins[i];
+               game.plugins[(round & 1) ^ 1] = mPlugins[j];
+               mGames.push_back(game);
+            }
+         }
+      }
+   }
+
+   /** Returns the number of games played so far */
+   size_t Tournament::getFinishedGames() const
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      return mFinishedGames;
+   }
+
+   /**
+    * Plays all games and blocks until the tournament ends. The callback is invoked from the worker
+    * threads after each game, one at a time.
+    */
+   void Tournament::run(GameFinishedCb gameFinishedCb)
+   {
+      ThreadPool pool(mSettings.threads);
+
+      LOG_INFO(DOM) << "Starting tournament: " << mPlugins.size() << " plugins, " << mGames.size()
+         << " games on " << pool.size() << " threads";
+
+      for (size_t i = 0; i < mGames.size(); ++i)
+      {
+         pool.post([this, i, gameFinishedCb]()
+         {
+            GameResult result;
+
+            {
+               std::lock_guard<std::mutex> lock(mMutex);
+               result = mGames[i];
+            }
+
+            playGame(result);
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            mGames[i] = result;
+            ++mFinishedGames;
+
+            if (gameFinishedCb)
+            {
+               gameFinishedCb(i, result);
+            }
+         });
+      }
+
+      pool.wait();
+
+      LOG_INFO(DOM) << "Tournament finished";
+   }
+
+   /** Returns the results of all games, in pairing order */
+   std::vector<GameResult> Tournament::getResults() const
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      return mGames;
+   }
+
+   /** Returns the standings, sorted by score. Elo ratings are computed in pairing order. */
+   std::vector<TournamentStanding> Tournament::getStandings() const
+   {
+      std::map<std::string, TournamentStanding> standings;
+
+      for (auto& p : mPlugins)
+      {
+         standings[p].plugin = p;
+         standings[p].elo = INITIAL_ELO;
+      }
+
+      for (auto& g : getResults())
+      {
+         if (not g.finished)
+         {
+            continue;
+         }
+
+         TournamentStanding* s[2] = { &standings[g.plugins[0]], &standings[g.plugins[1]] };
+
+         // Score of player 0: 1 for a win, 0.5 for a draw
+         double score = g.winner == 0xFF ? 0.5 : g.winner == 0 ? 1 : 0;
+         double expected = 1 / (1 + std::pow(10, (s[1]->elo - s[0]->elo) / 400));
+
+         s[0]->elo += ELO_K * (score - expected);
+         s[1]->elo -= ELO_K * (score - expected);
+
+         for (PlayerId id = 0; id < 2; ++id)
+         {
+            ++s[id]->games;
+
+            if (g.winner == 0xFF)
+            {
+               ++s[id]->draws;
+               s[id]->score += 0.5;
+            }
+            else if (g.winner == id)
+            {
+               ++s[id]->wins;
+               s[id]->score += 1;
+            }
+            else
+            {
+               ++s[id]->losses;
+               s[id]->timeouts += g.timeout;
+            }
+         }
+      }
+
+      std::vector<TournamentStanding> result;
+
+      for (auto& s : standings)
+      {
+         result.push_back(s.second);
+      }
+
+      std::sort(result.begin(), result.end(), [](const TournamentStanding& a, const TournamentStanding& b)
+         { return a.score != b.score ? a.score > b.score : a.elo > b.elo; });
+
+      return result;
+   }
+
+   /** Plays a single game in the calling thread */
+   void Tournament::playGame(GameResult& result) const
+   {
+      auto start = std::chrono::steady_clock::now();
+      auto game = std::make_shared<Game>(2);
+      PlayerPtr players[2];
+      PlayerClock clocks[2] = { PlayerClock(mSettings.timeControl), PlayerClock(mSettings.timeControl) };
+
+      for (PlayerId id = 0; id < 2; ++id)
+      {
+         players[id] = PluginManager::CreatePlayer(result.plugins[id], id, result.plugins[id], game);
+      }
+
+      while (not game->getBoardState()->isFinished())
+      {
+         if (result.moves >= mSettings.maxMoves)
+         {
+            game->end();
+            break;
+         }
+
+         PlayerId current = game->getCurrentPlayer();
+         auto moveStart = std::chrono::steady_clock::now();
+
+         try
+         {
+            players[current]->notifyMove();
+         }
+         catch (std::exception& e)
+         {
+            LOG_ERROR(DOM) << "Exception during player move: " << e.what();
+         }
+
+         // Players are allowed to decide on their own threads, within the time limit. Without a
+         // limit, a player that returned without moving would block the worker forever.
+         if (clocks[current].isLimited())
+         {
+            game->waitPlayerMoveUntil(current, clocks[current].getDeadline(moveStart));
+         }
+
+         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - moveStart);
+         players[current]->setLastMoveDuration(duration.count());
+
+         bool moved = game->getBoardState()->isFinished() or game->getCurrentPlayer() != current;
+
+         if (moved)
+         {
+            ++result.moves;
+         }
+
+         if (not clocks[current].stop(duration) or not moved)
+         {
+            LOG_WARN(DOM) << (moved ? "Time limit exceeded by " : "No move from ") << result.plugins[current] << " against " << result.plugins[current ^ 1];
+
+            // Lost even if a late move won, as the controller's watchdog would have rejected it
+            if (not game->getBoardState()->isFinished())
+            {
+               game->end();
+            }
+
+            result.winner = current ^ 1;
+            result.timeout = true;
+            break;
+         }
+      }
+
+      if (not result.timeout)
+      {
+         result.winner = game->getBoardState()->getWinner();
+      }
+
+      result.durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+      result.finished = true;
+
+      if (mSettings.recordWriter)
+      {
+         // The winner of a game lost on time isn't on the board
+         try
+         {
+            mSettings.recordWriter->append(game->getNumberOfPlayers(), result.winner, game->getActions());
+         }
+         catch (std::exception& e)
+         {
+            LOG_ERROR(DOM) << "Failed to record the game: " << e.what();
+         }
+      }
+   }
+} // namespace qcore
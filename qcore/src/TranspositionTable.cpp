@@ -0,0 +1,177 @@
+#include "TranspositionTable.h"
+#include "QcoreUtil.h"
+
+#include <new>
+#include <algorithm>
+
+namespace qcore
+{
+   /** Log domain */
+   const char * const DOM = "qcore::TT";
+
+   /** Cache line size, the alignment of the buckets */
+   static const size_t CACHE_LINE = 64;
+
+   /** Packs an entry with the generation of the search storing it */
+   static uint64_t packEntry(const TranspositionEntry& entry, uint8_t generation)
+   {
+      return uint64_t(uint32_t(entry.score)) |
+         uint64_t(entry.depth) << 32 |
+         uint64_t(static_cast<uint8_t>(entry.bound) & 0x3) << 40 |
+         uint64_t(generation & 0x3F) << 42 |
+         uint64_t(entry.action) << 48;
+   }
+
+   /** Unpacks an entry packed by packEntry() */
+   static TranspositionEntry unpackEntry(uint64_t data)
+   {
+      TranspositionEntry entry;
+      entry.score = int32_t(uint32_t(data));
+      entry.depth = uint8_t(data >> 32);
+      entry.bound = static_cast<Bound>((data >> 40) & 0x3);
+      entry.action = uint16_t(data >> 48);
+
+      return entry;
+   }
+
+   /** Returns the generation of a packed entry */
+   static uint8_t entryGeneration(uint64_t data)
+   {
+      return uint8_t((data >> 42) & 0x3F);
+   }
+
+   /** Construction of a table using at most the specified memory */
+   TranspositionTable::TranspositionTable(size_t megabytes) :
+      mBuckets(nullptr),
+      mMask(0),
+      mGeneration(0)
+   {
+      resize(megabytes);
+   }
+
+   /** Reallocates the table, discarding all entries. Not safe during a search. */
+   void TranspositionTable::resize(size_t megabytes)
+   {
+      size_t buckets = 1;
+
+      while (buckets * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024)
+      {
+         buckets *= 2;
+      }
+
+      mMemory.reset(new uint8_t[buckets * sizeof(Bucket) + CACHE_LINE]);
+      uintptr_t address = reinterpret_cast<uintptr_t>(mMemory.get());
+      mBuckets = reinterpret_cast<Bucket*>((address + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE);
+      mMask = buckets - 1;
+
+      for (size_t i = 0; i < buckets; ++i)
+      {
+         new (&mBuckets[i]) Bucket;
+      }
+
+      clear();
+
+      LOG_DEBUG(DOM) << "Transposition table of " << getCapacity() << " entries";
+   }
+
+   /** Discards all entries. Not safe during a search. */
+   void TranspositionTable::clear()
+   {
+      for (size_t i = 0; i <= mMask; ++i)
+      {
+         for (Slot& slot : mBuckets[i].slots)
+         {
+            slot.key.store(0, std::memory_order_relaxed);
+            slot.data.store(0, std::memory_order_relaxed);
+         }
+      }
+
+      mGeneration = 0;
+   }
+
+   /** Looks for a position. Returns false if the position was not stored or has been replaced. */
+   bool TranspositionTable::probe(uint64_t hash, TranspositionEntry& entry) const
+   {
+      for (const Slot& slot : getBucket(hash).slots)
+      {
+         uint64_t data = slot.data.load(std::memory_order_relaxed);
+
+         if ((slot.key.load(std::memory_order_relaxed) ^ data) == hash)
+         {
+            entry = unpackEntry(data);
+
+            // Empty slots verify against the hash 0
+            return entry.bound != Bound::None;
+         }
+      }
+
+      return false;
+   }
+
+   /**
+    * Stores the result of a position. A result of the same position is kept only if it was
+    * searched deeper in the current search; otherwise the least valuable entry of the bucket is
+    * replaced.
+    */
+   void TranspositionTable::store(uint64_t hash, const TranspositionEntry& entry)
+   {
+      Bucket& bucket = getBucket(hash);
+      Slot* victim = nullptr;
+      int victimValue = 0;
+
+      for (Slot& slot : bucket.slots)
+      {
+         uint64_t data = slot.data.load(std::memory_order_relaxed);
+
+         if ((slot.key.load(std::memory_order_relaxed) ^ data) == hash)
+         {
+            TranspositionEntry stored = unpackEntry(data);
+
+            if (entryGeneration(data) == mGeneration and stored.depth > entry.depth and entry.bound != Bound::Exact)
+            {
+               return;
+            }
+
+            victim = &slot;
+            break;
+         }
+
+         // Shallow entries of old searches are worth the least
+         int age = (mGeneration - entryGeneration(data)) & 0x3F;
+         int value = int(unpackEntry(data).depth) - 8 * age;
+
+         if (not victim or value < victimValue)
+         {
+            victim = &slot;
+            victimValue = value;
+         }
+      }
+
+      uint64_t data = packEntry(entry, mGeneration);
+      victim->key.store(hash ^ data, std::memory_order_relaxed);
+      victim->data.store(data, std::memory_order_relaxed);
+   }
+
+   /** Returns the permille of entries written by the current search, estimated on the first buckets */
+   unsigned TranspositionTable::getUsage() const
+   {
+      size_t buckets = std::min<size_t>(mMask + 1, 1000);
+      size_t used = 0;
+
+      for (size_t i = 0; i < buckets; ++i)
+      {
+         for (const Slot& slot : mBuckets[i].slots)
+         {
+            uint64_t data = slot.data.load(std::memory_order_relaxed);
+
+            if (entryGeneration(data) == mGeneration and unpackEntry(data).bound != Bound::None)
+            {
+               ++used;
+            }
+         }
+      }
+
+      return unsigned(used * 1000 / (buckets * BUCKET_SLOTS));
+   }
+
+} // namespace qcore
@@ -0,0 +1,370 @@
+#include "PluginManager.h"
+#include "GameController.h"
+#include "Game.h"
+#include "Tournament.h"
+#include "GameRecord.h"
+#include "GameReplay.h"
+
+#include <ConsoleApp.h>
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+
+typedef const qcli::ConsoleApp::CliArgs& qarg;
+
+/** Default number of games in a match */
+const uint32_t DEFAULT_GAMES = 100;
+
+/** Default time limit for a move, in milliseconds */
+const uint32_t DEFAULT_MOVE_TIME_MS = 5000;
+
+/** Default number of moves after which the game is declared a draw */
+const uint32_t DEFAULT_MAX_MOVES = 400;
+
+/** Results of one side of the match */
+struct ContenderStats
+{
+   std::string plugin;
+   uint32_t wins = 0;
+   uint32_t losses = 0;
+   uint32_t timeouts = 0;
+   uint32_t illegalMoves = 0;
+   uint32_t moves = 0;
+   uint64_t moveTimeMs = 0;
+   uint32_t maxMoveTimeMs = 0;
+};
+
+/** Results of the whole match */
+struct MatchStats
+{
+   ContenderStats contenders[2];
+   uint32_t games = 0;
+   uint32_t draws = 0;
+   uint64_t moves = 0;
+};
+
+qcore::GameController GC;
+
+/** Reads the time control options. Without any option, moves are limited to DEFAULT_MOVE_TIME_MS. */
+qcore::TimeControl ParseTimeControl(qarg args)
+{
+   qcore::TimeControl tc;
+   tc.budget = std::chrono::milliseconds(args.isSet("-b") ? std::stoul(args.getValue("<budget-ms>")) : 0);
+   tc.increment = std::chrono::milliseconds(args.isSet("-i") ? std::stoul(args.getValue("<increment-ms>")) : 0);
+   tc.moveLimit = std::chrono::milliseconds(args.isSet("-t") ? std::stoul(args.getValue("<move-ms>")) : args.isSet("-b") ? 0 : DEFAULT_MOVE_TIME_MS);
+
+   return tc;
+}
+
+/** Plays one game. Contenders swap sides on every game, contender 0 starts the first one. */
+void PlayGame(std::ostream& out, MatchStats& stats, uint32_t maxMoves, const qcore::GameRecordWriterPtr& recordWriter)
+{
+   const char * const NAMES[] = { "A", "B" };
+   uint8_t contender[2] = { uint8_t(stats.games & 1), uint8_t(not (stats.games & 1)) };
+
+   GC.initLocalGame(2);
+   GC.addPlayer(stats.contenders[contender[0]].plugin, NAMES[contender[0]]);
+   GC.addPlayer(stats.contenders[contender[1]].plugin, NAMES[contender[1]]);
+
+   auto game = GC.getGame();
+   uint32_t moves = 0;
+   uint32_t version = 0;
+
+   // Called from the player thread after each move
+   game->getBoardState()->registerStateChange([&]()
+   {
+      auto snapshot = game->getBoardState()->getSnapshot();
+
+      // Skip illegal move attempts and forced game termination
+      if (snapshot->getVersion() == version or (snapshot->isFinished() and snapshot->getWinner() == 0xFF))
+      {
+         return;
+      }
+
+      version = snapshot->getVersion();
+      ++moves;
+
+      auto player = GC.getPlayer(snapshot->getLastAction().playerId);
+      auto& s = stats.contenders[contender[player->getId()]];
+
+      ++s.moves;
+      s.moveTimeMs += player->getLastMoveDuration();
+      s.maxMoveTimeMs = std::max(s.maxMoveTimeMs, player->getLastMoveDuration());
+
+      if (moves >= maxMoves and not snapshot->isFinished())
+      {
+         game->end();
+      }
+   });
+
+   auto start = std::chrono::steady_clock::now();
+
+   GC.start();
+   GC.waitFinished();
+
+   auto durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+   auto snapshot = game->getBoardState()->getSnapshot();
+
+   for (qcore::PlayerId id = 0; id < 2; ++id)
+   {
+      stats.contenders[contender[id]].illegalMoves += GC.getPlayer(id)->getIllegalMoves();
+   }
+
+   out << "Game " << std::setw(5) << stats.games + 1 << ": ";
+
+   qcore::PlayerId winner = snapshot->getWinner();
+
+   if (winner != 0xFF)
+   {
+      ++stats.contenders[contender[snapshot->getWinner()]].wins;
+      ++stats.contenders[contender[snapshot->getWinner() ^ 1]].losses;
+
+      out << NAMES[contender[snapshot->getWinner()]] << " won";
+   }
+   else if (moves >= maxMoves)
+   {
+      ++stats.draws;
+
+      out << "draw";
+   }
+   else
+   {
+      // The player on move exceeded his time limit
+      qcore::PlayerId loser = game->getCurrentPlayer();
+
+      ++stats.contenders[contender[loser]].losses;
+      ++stats.contenders[contender[loser]].timeouts;
+      ++stats.contenders[contender[loser ^ 1]].wins;
+      winner = loser ^ 1;
+
+      out << NAMES[contender[loser ^ 1]] << " won (time limit exceeded by " << NAMES[contender[loser]] << ")";
+   }
+
+   out << " after " << moves << " moves [" << durationMs / 1000.0 << " sec]\n";
+
+   ++stats.games;
+   stats.moves += moves;
+
+   if (recordWriter)
+   {
+      recordWriter->append(2, winner, game->getActions());
+   }
+}
+
+/** Prints the results of the match */
+void PrintMatchStats(std::ostream& out, const MatchStats& stats, uint64_t durationMs)
+{
+   const char * const NAMES[] = { "A", "B" };
+
+   out << "\n" << std::left
+      << std::setw(4) << "" << std::setw(30) << "Plugin"
+      << std::setw(8) << "Wins" << std::setw(8) << "Losses" << std::setw(10) << "Timeouts" << std::setw(10) << "Illegal"
+      << std::setw(14) << "Avg move ms" << std::setw(14) << "Max move ms" << "\n";
+
+   for (int i = 0; i < 2; ++i)
+   {
+      const ContenderStats& s = stats.contenders[i];
+
+      out << std::setw(4) << NAMES[i] << std::setw(30) << s.plugin
+         << std::setw(8) << s.wins << std::setw(8) << s.losses << std::setw(10) << s.timeouts << std::setw(10) << s.illegalMoves
+         << std::setw(14) << (s.moves ? double(s.moveTimeMs) / s.moves : 0.0) << std::setw(14) << s.maxMoveTimeMs << "\n";
+   }
+
+   out << "\nGames: " << stats.games << ", draws: " << stats.draws
+      << ", moves per game: " << (stats.games ? double(stats.moves) / stats.games : 0.0)
+      << ", duration: " << durationMs / 1000.0 << " sec"
+      << ", games per hour: " << (durationMs ? stats.games * 3600000.0 / durationMs : 0.0) << "\n";
+}
+
+void RunCommand_Match(std::ostream& out, qarg args)
+{
+   MatchStats stats;
+   stats.contenders[0].plugin = args.getValue("<plugin-a>");
+   stats.contenders[1].plugin = args.getValue("<plugin-b>");
+
+   uint32_t games = args.isSet("-n") ? std::stoul(args.getValue("<games>")) : DEFAULT_GAMES;
+   uint32_t maxMoves = args.isSet("-m") ? std::stoul(args.getValue("<max-moves>")) : DEFAULT_MAX_MOVES;
+
+   // No artificial delay between moves
+   GC.setMinMoveTime(std::chrono::milliseconds(0));
+   GC.setTimeControl(ParseTimeControl(args));
+
+   // Recorded by PlayGame(), which knows the winner of games lost on time
+   qcore::GameRecordWriterPtr recordWriter;
+
+   if (args.isSet("-r"))
+   {
+      recordWriter = std::make_shared<qcore::GameRecordWriter>(args.getValue("<record-file>"));
+   }
+
+   auto start = std::chrono::steady_clock::now();
+
+   while (stats.games < games)
+   {
+      PlayGame(out, stats, maxMoves, recordWriter);
+   }
+
+   auto durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+   PrintMatchStats(out, stats, durationMs);
+}
+
+void RunCommand_Tournament(std::ostream& out, qarg args)
+{
+   qcore::TournamentSettings settings;
+   settings.gamesPerPair = args.isSet("-n") ? std::stoul(args.getValue("<games-per-pair>")) : 2;
+   settings.timeControl = ParseTimeControl(args);
+   settings.maxMoves = args.isSet("-m") ? std::stoul(args.getValue("<max-moves>")) : DEFAULT_MAX_MOVES;
+   settings.threads = args.isSet("-j") ? std::stoul(args.getValue("<threads>")) : 0;
+
+   if (args.isSet("-r"))
+   {
+      settings.recordWriter = std::make_shared<qcore::GameRecordWriter>(args.getValue("<record-file>"));
+   }
+
+   qcore::Tournament tournament(qcore::PluginManager::GetPluginList(), settings);
+   auto start = std::chrono::steady_clock::now();
+   size_t finished = 0;
+
+   // Callbacks are serialized by the tournament
+   tournament.run([&](size_t, const qcore::GameResult& r)
+   {
+      out << "Game " << std::setw(5) << ++finished << "/" << tournament.getNumberOfGames() << ": "
+         << r.plugins[0] << " vs " << r.plugins[1] << ": "
+         << (r.winner == 0xFF ? "draw" : r.plugins[r.winner] + " won") << (r.timeout ? " (time limit exceeded)" : "")
+         << " after " << r.moves << " moves [" << r.durationMs / 1000.0 << " sec]" << std::endl;
+   });
+
+   auto durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+   out << "\n" << std::left
+      << std::setw(4) << "#" << std::setw(30) << "Plugin" << std::setw(8) << "Score" << std::setw(8) << "Elo"
+      << std::setw(8) << "Games" << std::setw(8) << "Wins" << std::setw(8) << "Draws" << std::setw(8) << "Losses" << "Timeouts\n";
+
+   int rank = 0;
+
+   for (auto& s : tournament.getStandings())
+   {
+      out << std::setw(4) << ++rank << std::setw(30) << s.plugin << std::setw(8) << s.score << std::setw(8) << std::lround(s.elo)
+         << std::setw(8) << s.games << std::setw(8) << s.wins << std::setw(8) << s.draws << std::setw(8) << s.losses << s.timeouts << "\n";
+   }
+
+   out << "\nGames: " << tournament.getNumberOfGames() << ", duration: " << durationMs / 1000.0 << " sec"
+      << ", games per hour: " << (durationMs ? tournament.getNumberOfGames() * 3600000.0 / durationMs : 0.0) << "\n";
+}
+
+void RunCommand_Records(std::ostream& out, qarg args)
+{
+   qcore::GameRecordReader reader(args.getValue("<record-file>"));
+   uint64_t games = 0, draws = 0, moves = 0, walls = 0;
+   uint64_t wins[4] = {};
+
+   for (auto& game : reader)
+   {
+      for (uint32_t i = 0; i < game.getNumberOfActions(); ++i)
+      {
+         game.getAction(i).actionType == qcore::ActionType::Wall ? ++walls : ++moves;
+      }
+
+      game.getWinner() < 4 ? ++wins[game.getWinner()] : ++draws;
+      ++games;
+   }
+
+   out << "Games: " << games << ", draws: " << draws;
+
+   for (int i = 0; i < 4; ++i)
+   {
+      if (wins[i])
+      {
+         out << ", player " << i << " wins: " << wins[i];
+      }
+   }
+
+   out << "\nMoves: " << moves << ", walls: " << walls
+      << ", actions per game: " << (games ? double(moves + walls) / games : 0.0) << "\n";
+}
+
+void RunCommand_Replay(std::ostream& out, qarg args)
+{
+   qcore::GameRecordReader reader(args.getValue("<record-file>"));
+   uint64_t index = args.isSet("-g") ? std::stoull(args.getValue("<game>")) : 0;
+   auto game = reader.begin();
+
+   for (uint64_t i = 0; i < index and game != reader.end(); ++i)
+   {
+      ++game;
+   }
+
+   if (game == reader.end())
+   {
+      throw qcore::util::Exception("Unknown game " + std::to_string(index));
+   }
+
+   qcore::GameReplay replay(*game);
+   replay.seek(args.isSet("-a") ? std::stoul(args.getValue("<actions>")) : replay.getNumberOfActions());
+
+   qcore::BoardMap map;
+   qcore::BoardState(replay.getSnapshot()).createBoardMap(map, 0);
+
+   out << "Game " << index << " after " << replay.getPosition() << "/" << replay.getNumberOfActions() << " actions\n\n";
+
+   for (int i = 0; i < qcore::BOARD_MAP_SIZE; ++i)
+   {
+      out << "   ";
+
+      for (int j = 0; j < qcore::BOARD_MAP_SIZE; ++j)
+      {
+         switch (map(i, j))
+         {
+            case qcore::BoardMap::VertivalWall: out << '|'; break;
+            case qcore::BoardMap::HorizontalWall: out << '-'; break;
+            case qcore::BoardMap::Pawn0: out << '0'; break;
+            case qcore::BoardMap::Pawn1: out << '1'; break;
+            case qcore::BoardMap::Pawn2: out << '2'; break;
+            case qcore::BoardMap::Pawn3: out << '3'; break;
+            case qcore::BoardMap::MidWall: out << ' '; break;
+            case 0: out << (map.isPawnSpace(qcore::Position(i, j)) ? '.' : ' '); break;
+            default: out << map(i, j); break;
+         }
+      }
+
+      out << "\n";
+   }
+}
+
+int main(int argc, char *argv[])
+{
+   // Setup console application menu
+   qcli::ConsoleApp app(std::cout);
+
+   app.addCommand(RunCommand_Match, "run <plugin-a> <plugin-b> -n <games> -t <move-ms> -b <budget-ms> -i <increment-ms> -m <max-moves> -r <record-file>", "Match")
+      .setSummary("Plays a number of games between two plugins, without any delay between moves, and prints the results.")
+      .setDescription("Players swap sides after each game. A game ends in a draw after <max-moves> moves.\n"
+                      "Each player gets <budget-ms> for the whole game plus <increment-ms> after each move, and at most <move-ms> per move.\n"
+                      "The games are appended to <record-file>, if set.\n"
+                      "EXAMPLE:\n   run qplugin::DummyPlayer qplugin::ICPlayer -n 1000 -t 500");
+
+   app.addCommand(RunCommand_Tournament, "tournament -n <games-per-pair> -t <move-ms> -b <budget-ms> -i <increment-ms> -m <max-moves> -j <threads> -r <record-file>", "Match")
+      .setSummary("Plays a round-robin tournament between all available plugins, running games in parallel, and prints the standings.")
+      .setDescription("Each pair of plugins plays <games-per-pair> games (default 2), swapping sides after each game.\n"
+                      "Games are spread over <threads> worker threads (default: all hardware threads), and appended to <record-file>, if set.\n"
+                      "EXAMPLE:\n   tournament -n 10 -t 1000 -j 64");
+
+   app.addCommand(RunCommand_Records, "records <record-file>", "Match")
+      .setSummary("Prints a summary of the games of a record file.");
+
+   app.addCommand(RunCommand_Replay, "replay <record-file> -g <game> -a <actions>", "Match")
+      .setSummary("Prints the board of a recorded game.")
+      .setDescription("Replays game number <game> (default 0) of the record file, up to <actions> actions (default: the whole game).\n"
+                      "EXAMPLE:\n   replay games.qgr -g 12 -a 40");
+
+   app.addCommand([](std::ostream& out, qarg){ for (auto& p : qcore::PluginManager::GetPluginList()) out << "   " << p << "\n"; }, "plugins", "Match")
+      .setSummary("Lists all available plugins.");
+
+   app.addCommand([&app](std::ostream &, qarg){ app.printHelp(); }, "help", "General")
+      .setSummary("Prints this menu");
+
+   // Run a single command
+   return app.executeOnce(argc, argv);
+}
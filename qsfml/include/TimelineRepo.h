@@ -4,7 +4,7 @@
 #include <vector>
 
 #include "BoardState.h"
-#include "Game.h"
+#include "BoardHistory.h"
 
 template<typename T>
 class vector_thread_safe
@@ -42,20 +42,21 @@ private:
 	std::mutex _mtx;
 };
 
+// Entries share the previous actions, only the last action of each entry is stored
 struct TimelineEntry {
-	qcore::Game game;
+	qcore::BoardHistory history;
 
 	TimelineEntry() = delete;
 
-	TimelineEntry(const qcore::Game& g) : game(g) {};
+	TimelineEntry(const qcore::BoardHistory& h) : history(h) {};
 
-	TimelineEntry(const TimelineEntry& from) = default;// : map(from.map), game(from.game) {};
+	TimelineEntry(const TimelineEntry& from) = default;
 
-	TimelineEntry(TimelineEntry&& from) = default;// : map(from.map), game(from.game)	{};
+	TimelineEntry(TimelineEntry&& from) = default;
 
 	TimelineEntry& operator =(const TimelineEntry&) = default;
 
-	operator const qcore::BoardMap () { qcore::BoardMap map; game.getBoardState()->createBoardMap(map, 0); return map; }
+	operator const qcore::BoardMap () { qcore::BoardMap map; qcore::BoardState(history.getSnapshot()).createBoardMap(map, 0); return map; }
 };
 
 class TimelineRepo : public vector_thread_safe<TimelineEntry> {};
@@ -233,11 +233,11 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] const char** argv)
 
 	qcore::BoardState::StateChangeCb boardStateCb = [&GC, &timelineRepo]()
 	{
-		timelineRepo.push(TimelineEntry(GC.exportGame()));
+		timelineRepo.push(TimelineEntry(GC.getGame()->getHistory()));
 	};
 	GC.getBoardState()->registerStateChange(boardStateCb);
 	{
-		timelineRepo.push(TimelineEntry(GC.exportGame()));
+		timelineRepo.push(TimelineEntry(GC.getGame()->getHistory()));
 	}
 
 	BoardMapShowStrategy* currentShowStrategy = nullptr;
@@ -308,7 +308,7 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] const char** argv)
 			break;
 		case ImGuiTimelineWidget::TIMELINE_WIDGET_ID::RESUME:
 			timelineRepo.dropFrom(currentShowStrategy->getCurrentValue());
-			GC.loadGame(timelineRepo[currentShowStrategy->getCurrentValue()].game);
+			GC.loadGame(timelineRepo[currentShowStrategy->getCurrentValue()].history);
 			break;
 		case ImGuiTimelineWidget::TIMELINE_WIDGET_ID::STOP:
 			slideShowAnimationStrategy.stop();